@@ -0,0 +1,129 @@
+// Output on a fine time grid through dense output against shrinking the step
+// size until every output time is a step, and event location on the
+// interpolant. The harmonic oscillator x'' = -x has the exact solution
+// x = cos t, so both the interpolated states and the event times are checked.
+#include <Observer.h>
+#include <Problem.h>
+#include <Solver.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+class Oscillator : public ODE_Problem<double> {
+public:
+  Oscillator() {
+    this->r_0 = StateType{1, 0};
+    this->t_0 = 0;
+    this->dim = 2;
+  }
+  using ODE_Problem<double>::eval;
+  void eval(double t_i, const StateType &r_i, StateType &out) override {
+    out[0] = r_i[1];
+    out[1] = -r_i[0];
+  }
+};
+
+// largest deviation of the observed states from the exact solution
+class ErrorObserver : public Observer<Vector<double>> {
+public:
+  void observe(int step, double t, const Vector<double> &r) override {
+    double e = std::max(std::abs(r[0] - std::cos(t)),
+                        std::abs(r[1] + std::sin(t)));
+    if (!(e <= this->error)) {
+      this->error = e;
+    }
+    this->count++;
+  };
+  double error = 0;
+  long count = 0;
+};
+
+template <typename SolverType>
+void run(SolverType solver, const char *label, double dt,
+         const std::vector<double> &times, bool dense) {
+  ErrorObserver observer;
+  solver.setStoreHistory(false);
+  solver.setEndTime(times.back());
+  if (dense) {
+    solver.setOutputTimes(times, observer);
+  } else {
+    solver.addObserver(observer);
+  }
+  auto start = std::chrono::steady_clock::now();
+  solver.integrate();
+  double ms = std::chrono::duration<double, std::milli>(
+                  std::chrono::steady_clock::now() - start)
+                  .count();
+  std::printf("%-28s %9.1e %9d %10ld %9ld %10.3f %12.3e\n", label, dt,
+              solver.getSteps(), solver.getRhsEvaluations(), observer.count,
+              ms, observer.error);
+}
+
+// zero crossings of x are at (k + 1/2) pi, the velocity x' first turns
+// positive at pi, where a terminal event on it ends the run
+template <typename SolverType>
+void events(const SolverType &solver, const char *label, double tEnd) {
+  History<Vector<double>> crossings;
+  SolverType crossing = solver;
+  crossing.setStoreHistory(false);
+  crossing.setEndTime(tEnd);
+  crossing.addEvent([](double t, const Vector<double> &r) { return r[0]; },
+                    crossings);
+  crossing.integrate();
+  double err = 0;
+  for (std::size_t k = 0; k < crossings.getT().size(); k++) {
+    err = std::max(err, std::abs(crossings.getT()[k] - (k + 0.5) * M_PI));
+  }
+
+  KeepLast<Vector<double>> event;
+  SolverType terminal = solver;
+  terminal.setStoreHistory(false);
+  terminal.setEndTime(tEnd);
+  terminal.addEvent([](double t, const Vector<double> &r) { return r[1]; },
+                    event, true);
+  terminal.integrate();
+  std::printf("%-28s %9zu %12.3e %12.3e %12.3e\n", label,
+              crossings.getT().size(), err, std::abs(event.getT() - M_PI),
+              std::abs(terminal.getR()[0] + 1));
+}
+
+int main() {
+  Oscillator problem;
+  const double tEnd = 20;
+  const double outputStep = 1e-3;
+  const int maxI = 100000000;
+  std::vector<double> times;
+  for (long k = 0; k * outputStep <= tEnd * (1 + 1e-12); k++) {
+    times.push_back(k * outputStep);
+  }
+
+  std::printf("harmonic oscillator on [0, %g], output every %g\n", tEnd,
+              outputStep);
+  std::printf("%-28s %9s %9s %10s %9s %10s %12s\n", "method", "dt", "steps",
+              "rhs evals", "outputs", "time [ms]", "max error");
+  using RK4 = RungeKutta4<Oscillator, double>;
+  using EE = ExplicitEuler<Oscillator, double>;
+  using DP54 = DormandPrince54<Oscillator, double>;
+  run(RK4(problem, outputStep, maxI), "RK4, step per output",
+      outputStep, times, false);
+  for (double dt : {0.1, 0.05, 0.025}) {
+    run(RK4(problem, dt, maxI), "RK4, Hermite", dt, times, true);
+  }
+  run(EE(problem, outputStep, maxI), "Euler, step per output", outputStep,
+      times, false);
+  run(EE(problem, 10 * outputStep, maxI), "Euler, Hermite",
+      10 * outputStep, times, true);
+  for (double tol : {1e-6, 1e-9}) {
+    DP54 solver(problem, 0, maxI, tol, tol);
+    run(solver, tol == 1e-6 ? "DP54 1e-6, continuous ext." :
+                              "DP54 1e-9, continuous ext.",
+        0, times, true);
+  }
+
+  std::printf("\nevents: x = 0 on [0, %g], terminal x' = 0 at pi\n", tEnd);
+  std::printf("%-28s %9s %12s %12s %12s\n", "method", "crossings",
+              "max error", "stop error", "x(stop) + 1");
+  events(RK4(problem, 0.1, maxI), "RK4 dt 0.1", tEnd);
+  events(DP54(problem, 0, maxI, 1e-9, 1e-9), "DP54 1e-9", tEnd);
+  return 0;
+}
@@ -0,0 +1,159 @@
+// Cost of the dispatch around cheap right hand sides: RungeKutta4 on the
+// Lorenz attractor and a small linear system, with the problem behind
+// VirtualProblem and the steps called through the vtable, on the concrete
+// problem type, on a lambda in a FunctionProblem, and a hand written loop over
+// plain arrays as the lower bound. All variants compute the same trajectory.
+// First the tableau solvers are checked for their order of convergence.
+#include <Problem.h>
+#include <Solver.h>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+
+template <typename F> double nsPerStep(F run, int nSteps) {
+  auto start = std::chrono::steady_clock::now();
+  run();
+  auto stop = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(stop - start).count() /
+         nSteps;
+}
+
+// rhs(r, out) is generic over the container, it is called on Vector in the
+// lambda and on std::array in the hand written loop
+template <typename P, int N, typename Rhs>
+void compare(const char *title, const P &problem,
+             std::shared_ptr<ODE_Problem<double, N>> shared, Rhs rhs,
+             int nSteps, double dt) {
+  using Fixed = Vector<double, N>;
+  auto lambda = [rhs](double t, const Fixed &r, Fixed &out) { rhs(r, out); };
+  FunctionProblem<decltype(lambda), double, N> function(lambda, problem.r_0);
+  VirtualProblem<double, N> dynamic(shared);
+
+  std::printf("\n%s, %d RungeKutta4 steps\n", title, nSteps);
+  std::printf("%-36s %10s %14s\n", "variant", "ns/step", "r[0]");
+
+  RungeKutta4<VirtualProblem<double, N>, double> virtualSolver(dynamic, dt,
+                                                               nSteps);
+  virtualSolver.setStoreHistory(false);
+  // integrate() of the Solver base, every step goes through the vtable
+  double ns = nsPerStep(
+      [&] {
+        virtualSolver
+            .Solver<VirtualProblem<double, N>, double>::integrate();
+      },
+      nSteps);
+  std::printf("%-36s %10.2f %14.8f\n", "VirtualProblem, virtual step()", ns,
+              virtualSolver.getR()[0]);
+
+  RungeKutta4<P, double> directSolver(problem, dt, nSteps);
+  directSolver.setStoreHistory(false);
+  ns = nsPerStep([&] { directSolver.integrate(); }, nSteps);
+  std::printf("%-36s %10.2f %14.8f\n", "concrete problem, direct step()", ns,
+              directSolver.getR()[0]);
+
+  RungeKutta4<decltype(function), double> lambdaSolver(function, dt, nSteps);
+  lambdaSolver.setStoreHistory(false);
+  ns = nsPerStep([&] { lambdaSolver.integrate(); }, nSteps);
+  std::printf("%-36s %10.2f %14.8f\n", "FunctionProblem lambda", ns,
+              lambdaSolver.getR()[0]);
+
+  // the same arithmetic on plain arrays
+  std::array<double, N> r, k1, k2, k3, k4, tmp;
+  for (int j = 0; j < N; j++) {
+    r[j] = problem.r_0[j];
+  }
+  ns = nsPerStep(
+      [&] {
+        for (int s = 0; s < nSteps; s++) {
+          rhs(r, k1);
+          for (int j = 0; j < N; j++) {
+            tmp[j] = r[j] + (dt * 0.5) * k1[j];
+          }
+          rhs(tmp, k2);
+          for (int j = 0; j < N; j++) {
+            tmp[j] = r[j] + (dt * 0.5) * k2[j];
+          }
+          rhs(tmp, k3);
+          for (int j = 0; j < N; j++) {
+            tmp[j] = r[j] + dt * k3[j];
+          }
+          rhs(tmp, k4);
+          for (int j = 0; j < N; j++) {
+            r[j] += (dt / 6) * k1[j] + (dt / 3) * k2[j] + (dt / 3) * k3[j] +
+                    (dt / 6) * k4[j];
+          }
+        }
+      },
+      nSteps);
+  std::printf("%-36s %10.2f %14.8f\n", "hand written loop", ns, r[0]);
+}
+
+// observed order of a tableau solver from the errors at dt and dt / 2 on
+// r' = -r, t in [0, 1]. A wrong coefficient in a tableau still converges but
+// drops the order
+template <template <typename, typename> class SolverType>
+bool checkOrder(const char *name, int order) {
+  Vector<double, 2> r0{1, 2};
+  Linear_ODE_N<2> problem(r0, 0, -1);
+  double err[2];
+  for (int i = 0; i < 2; i++) {
+    SolverType<Linear_ODE_N<2>, double> solver(problem, 0.05 / (1 << i),
+                                               1000);
+    solver.setStoreHistory(false);
+    solver.setEndTime(1);
+    solver.integrate();
+    err[i] = 0;
+    for (int j = 0; j < 2; j++) {
+      err[i] = std::max(err[i],
+                        std::abs(solver.getR()[j] - r0[j] * std::exp(-1.0)));
+    }
+  }
+  double observed = std::log2(err[0] / err[1]);
+  std::printf("%-14s %6d %9.2f\n", name, order, observed);
+  if (!(observed > order - 0.2)) {
+    std::printf("%s: expected order %d\n", name, order);
+    return false;
+  }
+  return true;
+}
+
+int main() {
+  spdlog::set_level(spdlog::level::warn);
+  std::printf("%-14s %6s %9s\n", "solver", "order", "observed");
+  bool ok = checkOrder<ExplicitEuler>("ExplicitEuler", 1);
+  ok &= checkOrder<Midpoint>("Midpoint", 2);
+  ok &= checkOrder<Heun>("Heun", 2);
+  ok &= checkOrder<Kutta3>("Kutta3", 3);
+  ok &= checkOrder<RungeKutta4>("RungeKutta4", 4);
+  ok &= checkOrder<RungeKutta38>("RungeKutta38", 4);
+  if (!ok) {
+    return 1;
+  }
+
+  const int nSteps = 2000000;
+  auto lorenz = [](const auto &r, auto &out) {
+    out[0] = 10 * (r[1] - r[0]);
+    out[1] = r[0] * (28 - r[2]) - r[1];
+    out[2] = r[0] * r[1] - 8.0 / 3 * r[2];
+  };
+  auto linear = [](const auto &r, auto &out) {
+    for (int j = 0; j < 4; j++) {
+      out[j] = -0.5 * r[j];
+    }
+  };
+
+  Vector<double, 3> lorenz0{1, 1, 1};
+  LorenzAttractor lorenzProblem(lorenz0, 0);
+  compare<LorenzAttractor, 3>("Lorenz attractor", lorenzProblem,
+                              std::make_shared<LorenzAttractor>(lorenzProblem),
+                              lorenz, nSteps, 1e-5);
+
+  Vector<double, 4> linear0{1, 2, 3, 4};
+  Linear_ODE_N<4> linearProblem(linear0, 0, -0.5);
+  compare<Linear_ODE_N<4>, 4>(
+      "linear system, dim 4", linearProblem,
+      std::make_shared<Linear_ODE_N<4>>(linearProblem), linear, nSteps, 1e-5);
+  return 0;
+}
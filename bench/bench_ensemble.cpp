@@ -0,0 +1,80 @@
+// Sweep over many initial conditions: one RungeKutta4 per trajectory versus a
+// single lockstep RungeKutta4 over the structure of arrays Ensemble.
+#include <Ensemble.h>
+#include <Problem.h>
+#include <Solver.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+template <typename ProblemType>
+class BenchRK4 : public RungeKutta4<ProblemType, double> {
+public:
+  using RungeKutta4<ProblemType, double>::RungeKutta4;
+  using RungeKutta4<ProblemType, double>::step;
+};
+
+template <typename ProblemType>
+void sweep(const char *label, ProblemType problem,
+           const std::vector<typename ProblemType::StateType> &initial,
+           int nSteps, double dt) {
+  int n = initial.size();
+
+  double scalarSum = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int j = 0; j < n; j++) {
+    problem.r_0 = initial[j];
+    BenchRK4<ProblemType> solver(problem, dt, nSteps);
+    solver.setStoreHistory(false);
+    for (int s = 0; s < nSteps; s++) {
+      solver.step();
+    }
+    scalarSum += solver.getR()[0];
+  }
+  auto stop = std::chrono::steady_clock::now();
+  double scalarNs =
+      std::chrono::duration<double, std::nano>(stop - start).count();
+
+  Ensemble<ProblemType> ensemble(problem, initial);
+  start = std::chrono::steady_clock::now();
+  BenchRK4<Ensemble<ProblemType>> solver(ensemble, dt, nSteps);
+  solver.setStoreHistory(false);
+  for (int s = 0; s < nSteps; s++) {
+    solver.step();
+  }
+  stop = std::chrono::steady_clock::now();
+  double ensembleNs =
+      std::chrono::duration<double, std::nano>(stop - start).count();
+  double ensembleSum = 0;
+  for (int j = 0; j < n; j++) {
+    ensembleSum += ensemble.trajectory(solver.getR(), j)[0];
+  }
+
+  if (std::abs(scalarSum - ensembleSum) > 1e-8 * std::abs(scalarSum)) {
+    std::printf("results differ: %f vs %f\n", scalarSum, ensembleSum);
+  }
+  double steps = double(n) * nSteps;
+  std::printf("%-12s %8d %18.2f %18.2f %9.1fx\n", label, n, scalarNs / steps,
+              ensembleNs / steps, scalarNs / ensembleNs);
+}
+
+int main() {
+  spdlog::set_level(spdlog::level::warn);
+  const int nSteps = 1000;
+  std::printf("%-12s %8s %18s %18s %10s\n", "problem", "N",
+              "scalar ns/step", "ensemble ns/step", "speedup");
+  for (int n : {64, 1024, 16384}) {
+    std::vector<Vector<double, 1>> linearInitial;
+    std::vector<Vector<double, 3>> lorenzInitial;
+    for (int j = 0; j < n; j++) {
+      double u = double(j) / n;
+      linearInitial.push_back({1 + u});
+      lorenzInitial.push_back({1 + u, 1 - u, 20 + u});
+    }
+    Linear_ODE_N<1> linear(linearInitial[0], 0, -0.5);
+    LorenzAttractor lorenz(lorenzInitial[0], 0);
+    sweep("Linear_ODE", linear, linearInitial, nSteps, 1e-3);
+    sweep("Lorenz", lorenz, lorenzInitial, nSteps, 1e-3);
+  }
+  return 0;
+}
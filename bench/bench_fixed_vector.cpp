@@ -0,0 +1,64 @@
+// Many short RK4 integrations of a 3 dimensional system, with the state held
+// in a runtime sized Vector<double> versus a fixed size Vector<double, 3>.
+#include <Problem.h>
+#include <Solver.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+template <typename ProblemType>
+class BenchRK4 : public RungeKutta4<ProblemType, double> {
+public:
+  using RungeKutta4<ProblemType, double>::RungeKutta4;
+  using RungeKutta4<ProblemType, double>::step;
+};
+
+// integrates nRuns trajectories of nSteps each and returns ns per trajectory
+template <typename ProblemType>
+double integrate(const ProblemType &problem, int nRuns, int nSteps,
+                 double &checksum) {
+  auto start = std::chrono::steady_clock::now();
+  for (int n = 0; n < nRuns; n++) {
+    BenchRK4<ProblemType> solver(problem, 1e-3, nSteps);
+    solver.setStoreHistory(false);
+    for (int j = 0; j < nSteps; j++) {
+      solver.step();
+    }
+    checksum += solver.getR()[0];
+  }
+  auto stop = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(stop - start).count() /
+         nRuns;
+}
+
+int main() {
+  spdlog::set_level(spdlog::level::warn);
+  const int nRuns = 100000;
+  const int nSteps = 100;
+
+  std::vector<double> r0_ = {1, 2, 3};
+  Vector<double> r0Dynamic(r0_);
+  Vector<double, 3> r0Fixed(r0_);
+
+  Linear_ODE linearDynamic(r0Dynamic, 0, -0.5);
+  Linear_ODE_N<3> linearFixed(r0Fixed, 0, -0.5);
+  LorenzAttractor lorenz(r0Fixed, 0);
+
+  double dynamicSum = 0, fixedSum = 0, lorenzSum = 0;
+  double dynamicNs = integrate(linearDynamic, nRuns, nSteps, dynamicSum);
+  double fixedNs = integrate(linearFixed, nRuns, nSteps, fixedSum);
+  double lorenzNs = integrate(lorenz, nRuns, nSteps, lorenzSum);
+
+  if (std::abs(dynamicSum - fixedSum) > 1e-9 * std::abs(dynamicSum)) {
+    std::printf("results differ: %f vs %f\n", dynamicSum, fixedSum);
+    return 1;
+  }
+  std::printf("%d integrations of %d RK4 steps, ns per integration\n", nRuns,
+              nSteps);
+  std::printf("  Linear_ODE      (Vector<double>)    %10.1f\n", dynamicNs);
+  std::printf("  Linear_ODE_N<3> (Vector<double, 3>) %10.1f  (%.1fx)\n",
+              fixedNs, dynamicNs / fixedNs);
+  std::printf("  LorenzAttractor                     %10.1f  (checksum %f)\n",
+              lorenzNs, lorenzSum);
+  return 0;
+}
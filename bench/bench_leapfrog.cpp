@@ -0,0 +1,135 @@
+// Energy drift and throughput of the symplectic Leapfrog against
+// RungeKutta4 for N_Body. The step sizes give every solver the same number
+// of force evaluations per unit of time.
+#include <Problem.h>
+#include <Solver.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// two bodies of mass 1/2 on a Kepler orbit of eccentricity e, period 2 pi
+static Vector<Body> kepler(double e) {
+  double v = std::sqrt((1 - e) / (1 + e));
+  Vector<Body> bodies(2);
+  bodies[0] = Body(0.5, 0.5 * (1 + e), 0, 0, 0.5 * v);
+  bodies[1] = Body(0.5, -0.5 * (1 + e), 0, 0, -0.5 * v);
+  bodies[1].objectID = 1;
+  return bodies;
+}
+
+static Vector<Body> randomDisk(int n, unsigned seed) {
+  std::mt19937 gen(seed);
+  std::uniform_real_distribution<double> uniform(0, 1);
+  Vector<Body> bodies(n);
+  for (int i = 0; i < n; i++) {
+    double r = std::sqrt(uniform(gen)), phi = 2 * M_PI * uniform(gen);
+    bodies[i] = Body(1.0 / n, r * std::cos(phi), r * std::sin(phi),
+                     -r * std::sin(phi), r * std::cos(phi));
+    bodies[i].objectID = i;
+  }
+  return bodies;
+}
+
+// integrates to tEnd in nChecks chunks, prints the largest and the final
+// relative energy error and the force evaluations per second
+template <typename SolverType>
+void run(SolverType &solver, N_Body &problem, double tEnd, int nChecks,
+         const char *label, double dt) {
+  solver.setStoreHistory(false);
+  double e0 = problem.energy(solver.getR());
+  double maxErr = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int k = 1; k <= nChecks; k++) {
+    solver.setEndTime(tEnd * k / nChecks);
+    solver.integrate();
+    double err = std::abs((problem.energy(solver.getR()) - e0) / e0);
+    maxErr = std::max(maxErr, err);
+  }
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+  double finalErr = std::abs((problem.energy(solver.getR()) - e0) / e0);
+  std::printf("%-20s %8.4f %12ld %14.3e %14.3e %12.3e\n", label, dt,
+              solver.getRhsEvaluations(), maxErr, finalErr,
+              solver.getRhsEvaluations() / seconds);
+}
+
+template <typename Make> void compare(Make makeProblem, double h, double tEnd,
+                                      int nChecks) {
+  const int maxI = 100000000;
+  std::printf("%-20s %8s %12s %14s %14s %12s\n", "solver", "dt", "force evals",
+              "max |dE/E|", "final |dE/E|", "evals/s");
+  N_Body problem = makeProblem();
+  Leapfrog<N_Body, Body> leapfrog(problem, h, maxI);
+  run(leapfrog, problem, tEnd, nChecks, "Leapfrog", h);
+  Leapfrog<N_Body, Body> yoshida(problem, 3 * h, maxI, 4);
+  run(yoshida, problem, tEnd, nChecks, "Leapfrog Yoshida 4", 3 * h);
+  RungeKutta4<N_Body, Body> rk4(problem, 4 * h, maxI);
+  run(rk4, problem, tEnd, nChecks, "RungeKutta4", 4 * h);
+}
+
+// Dense output takes the derivatives of the interpolant from the kicks, so
+// output times between the steps cost no force evaluations. The interpolated
+// states between the steps of a Kepler orbit conserve the energy about as
+// well as the steps themselves
+static bool checkDenseOutput() {
+  const int nSteps = 1000;
+  const double h = 0.01;
+  Vector<Body> bodies = kepler(0.5);
+  N_Body problem(bodies, 0, 1);
+  Leapfrog<N_Body, Body> plain(problem, h, nSteps);
+  plain.setStoreHistory(false);
+  plain.integrate();
+
+  Leapfrog<N_Body, Body> dense(problem, h, nSteps);
+  dense.setStoreHistory(false);
+  History<Vector<Body>> output;
+  std::vector<double> times;
+  for (int k = 0; k < nSteps; k++) {
+    times.push_back((k + 0.5) * h);
+  }
+  dense.setOutputTimes(times, output);
+  dense.integrate();
+
+  double e0 = problem.energy(bodies), maxErr = 0;
+  for (const Vector<Body> &r : output.getR()) {
+    maxErr = std::max(maxErr, std::abs((problem.energy(r) - e0) / e0));
+  }
+  std::printf("dense output at %zu times: %ld force evals, %ld without, "
+              "max |dE/E| %.2e\n\n",
+              output.getR().size(), dense.getRhsEvaluations(),
+              plain.getRhsEvaluations(), maxErr);
+  return output.getR().size() == times.size() &&
+         dense.getRhsEvaluations() == plain.getRhsEvaluations() &&
+         maxErr < 1e-3;
+}
+
+int main() {
+  spdlog::set_level(spdlog::level::warn);
+  if (!checkDenseOutput()) {
+    std::printf("Leapfrog dense output evaluates the forces again\n");
+    return 1;
+  }
+
+  std::printf("Kepler orbit, e = 0.5, 1000 periods\n");
+  compare(
+      [] {
+        Vector<Body> bodies = kepler(0.5);
+        return N_Body(bodies, 0, 1);
+      },
+      0.01, 2000 * M_PI, 997);
+
+  std::printf("\n1024 bodies, softening 0.05, t = 10\n");
+  compare(
+      [] {
+        Vector<Body> bodies = randomDisk(1024, 42);
+        N_Body problem(bodies, 0, 1);
+        problem.setSoftening(0.05);
+        problem.setForceMethod(N_Body::DIRECT_SIMD);
+        return problem;
+      },
+      0.005, 10, 10);
+  return 0;
+}
@@ -0,0 +1,153 @@
+// Accuracy and cost of the N_Body force evaluation: direct summation against
+// Barnes-Hut for several opening angles and numbers of bodies.
+#include <Problem.h>
+#include <Solver.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+static Vector<Body> randomDisk(int n, unsigned seed) {
+  std::mt19937 gen(seed);
+  std::uniform_real_distribution<double> uniform(0, 1);
+  Vector<Body> bodies(n);
+  for (int i = 0; i < n; i++) {
+    double r = std::sqrt(uniform(gen)), phi = 2 * M_PI * uniform(gen);
+    bodies[i] = Body(1.0 / n, r * std::cos(phi), r * std::sin(phi),
+                     -r * std::sin(phi), r * std::cos(phi));
+    bodies[i].objectID = i;
+  }
+  return bodies;
+}
+
+template <typename F> double timeMs(F f, int reps = 1) {
+  auto start = std::chrono::steady_clock::now();
+  for (int k = 0; k < reps; k++) {
+    f();
+  }
+  auto stop = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::milli>(stop - start).count() /
+         reps;
+}
+
+// A light body in one corner of the root and a heavy one in the opposite
+// corner: the centre of mass of the root is further from the light body than
+// the root is wide, so at theta = 1 the root passes the opening test although
+// it contains the light body. Its monopole would pull the body on itself
+static bool checkSelfForce() {
+  Vector<Body> bodies(2);
+  bodies[0] = Body(0.1, 0, 0, 0, 0);
+  bodies[1] = Body(1, 1, 1, 0, 0);
+  N_Body problem(bodies, 0, 1);
+  Vector<Body> reference(2), approx(2);
+  problem.eval(0, bodies, reference);
+  problem.setForceMethod(N_Body::BARNES_HUT);
+  problem.setOpeningAngle(1);
+  problem.eval(0, bodies, approx);
+  double err = 0;
+  for (int i = 0; i < 2; i++) {
+    for (int c = 0; c < 2; c++) {
+      err = std::max(err, std::abs(approx[i].velocity[c] -
+                                   reference[i].velocity[c]) /
+                              std::abs(reference[i].velocity[c]));
+    }
+  }
+  std::printf("two bodies, theta 1: max rel error %.2e\n", err);
+  return err < 1e-12;
+}
+
+// pairs of coincident bodies without softening attract neither each other
+// nor with inf or NaN the others, all force methods have to agree. Enough
+// bodies for full rows of the SIMD kernels
+static bool checkCoincident() {
+  const int n = 20;
+  Vector<Body> bodies(n);
+  for (int i = 0; i < n; i++) {
+    bodies[i] = Body(1 + i % 3, i % 5, i / 5 + 0.1 * i, 0, 0);
+  }
+  bodies[1].position = bodies[0].position;
+  bodies[14].position = bodies[5].position;
+  N_Body problem(bodies, 0, 1);
+  Vector<Body> reference(n), approx(n);
+  problem.eval(0, bodies, reference);
+  double err = 0, scale = 0;
+  for (int i = 0; i < n; i++) {
+    scale = std::max(scale, std::abs(reference[i].velocity[0]) +
+                                std::abs(reference[i].velocity[1]));
+  }
+  for (N_Body::ForceMethod method : {N_Body::BARNES_HUT, N_Body::DIRECT_SIMD}) {
+    problem.setForceMethod(method);
+    problem.setOpeningAngle(0);
+    problem.eval(0, bodies, approx);
+    for (int i = 0; i < n; i++) {
+      for (int c = 0; c < 2; c++) {
+        double d =
+            std::abs(approx[i].velocity[c] - reference[i].velocity[c]) / scale;
+        // std::max would drop a NaN
+        err = std::isfinite(d) ? std::max(err, d) : INFINITY;
+      }
+    }
+  }
+  std::printf("coincident bodies: max rel difference %.2e\n\n", err);
+  return err < 1e-12;
+}
+
+int main() {
+  spdlog::set_level(spdlog::level::warn);
+  if (!checkSelfForce()) {
+    std::printf("Barnes-Hut applies the force of a body on itself\n");
+    return 1;
+  }
+  if (!checkCoincident()) {
+    std::printf("the force methods disagree on coincident bodies\n");
+    return 1;
+  }
+  std::printf("%8s %8s %14s %14s\n", "N", "theta", "eval [ms]",
+              "rms rel error");
+  for (int n : {1000, 4000, 16000, 64000, 256000}) {
+    Vector<Body> bodies = randomDisk(n, 42);
+    N_Body problem(bodies, 0, 1);
+    problem.setSoftening(1e-3);
+
+    Vector<Body> reference(n), approx(n);
+    bool haveReference = n <= 16000;
+    if (haveReference) {
+      problem.setForceMethod(N_Body::DIRECT);
+      double ms = timeMs([&] { problem.eval(0, bodies, reference); });
+      std::printf("%8d %8s %14.2f %14s\n", n, "direct", ms, "-");
+    }
+    problem.setForceMethod(N_Body::BARNES_HUT);
+    for (double theta : {0.3, 0.5, 0.8, 1.0}) {
+      problem.setOpeningAngle(theta);
+      double ms = timeMs([&] { problem.eval(0, bodies, approx); }, 3);
+      if (!haveReference) {
+        std::printf("%8d %8.1f %14.2f %14s\n", n, theta, ms, "-");
+        continue;
+      }
+      double err = 0, norm = 0;
+      for (int i = 0; i < n; i++) {
+        double ex = approx[i].velocity[0] - reference[i].velocity[0];
+        double ey = approx[i].velocity[1] - reference[i].velocity[1];
+        err += ex * ex + ey * ey;
+        norm += reference[i].velocity[0] * reference[i].velocity[0] +
+                reference[i].velocity[1] * reference[i].velocity[1];
+      }
+      std::printf("%8d %8.1f %14.2f %14.2e\n", n, theta, ms,
+                  std::sqrt(err / norm));
+    }
+  }
+
+  // a short Barnes-Hut RK4 run to check energy conservation end to end
+  Vector<Body> bodies = randomDisk(2000, 7);
+  N_Body problem(bodies, 0, 1);
+  problem.setSoftening(1e-2);
+  problem.setForceMethod(N_Body::BARNES_HUT);
+  RungeKutta4<N_Body, Body> solver(problem, 1e-3, 100);
+  solver.setStoreHistory(false);
+  double e0 = problem.energy(bodies);
+  double ms = timeMs([&] { solver.integrate(); });
+  std::printf("\nRK4, 2000 bodies, 100 steps: %.1f ms, relative energy "
+              "change %.2e\n",
+              ms, std::abs(problem.energy(solver.getR()) - e0) / std::abs(e0));
+  return 0;
+}
@@ -0,0 +1,120 @@
+// Pair interactions per second of the tiled SIMD direct-sum kernel on the
+// structure of arrays particle store against the scalar reference loop, for
+// every instruction set the CPU supports.
+#include <Particles.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+static void randomDisk(ParticleSystem &p, int n, unsigned seed) {
+  std::mt19937 gen(seed);
+  std::uniform_real_distribution<double> uniform(0, 1);
+  p.resize(n);
+  for (int i = 0; i < n; i++) {
+    double r = std::sqrt(uniform(gen)), phi = 2 * M_PI * uniform(gen);
+    p.x[i] = r * std::cos(phi);
+    p.y[i] = r * std::sin(phi);
+    p.vx[i] = -p.y[i];
+    p.vy[i] = p.x[i];
+    p.m[i] = 1.0 / n;
+  }
+}
+
+// seconds per call, repeated until at least 0.2 s have passed
+template <typename F> double timeSeconds(F f) {
+  int reps = 0;
+  auto start = std::chrono::steady_clock::now();
+  double elapsed = 0;
+  do {
+    f();
+    reps++;
+    elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                            start)
+                  .count();
+  } while (elapsed < 0.2);
+  return elapsed / reps;
+}
+
+// Without softening, squared distances outside the normal range of float
+// must not break the kernels' single precision estimates of 1 / sqrt
+static bool checkRange(SimdLevel best) {
+  bool ok = true;
+  for (double scale : {1e-25, 1e25}) {
+    ParticleSystem reference, particles;
+    randomDisk(reference, 64, 7);
+    for (int i = 0; i < reference.size(); i++) {
+      reference.x[i] *= scale;
+      reference.y[i] *= scale;
+    }
+    for (SimdLevel level :
+         {SimdLevel::SCALAR, SimdLevel::AVX2, SimdLevel::AVX512}) {
+      if (level > best) {
+        continue;
+      }
+      particles = reference;
+      computeAccelerationsReference(reference, 1, 0);
+      computeAccelerations(particles, 1, 0, level);
+      double err = 0;
+      for (int i = 0; i < reference.size(); i++) {
+        double ex = particles.ax[i] - reference.ax[i];
+        double ey = particles.ay[i] - reference.ay[i];
+        double norm = std::hypot(reference.ax[i], reference.ay[i]);
+        double e = std::hypot(ex, ey) / norm;
+        // a nan error has to fail the check as well
+        if (!(e <= err)) {
+          err = e;
+        }
+      }
+      if (!(err < 1e-10)) {
+        std::printf("%s at scale %g: max rel error %g\n",
+                    simdLevelName(level), scale, err);
+        ok = false;
+      }
+    }
+  }
+  return ok;
+}
+
+int main() {
+  const double gravity = 1, softening = 1e-3;
+  SimdLevel best = bestSimdLevel();
+  if (!checkRange(best)) {
+    return 1;
+  }
+  std::printf("best instruction set: %s\n", simdLevelName(best));
+  std::printf("%8s %10s %14s %10s %14s\n", "N", "kernel", "pairs/s",
+              "speedup", "max rel error");
+  for (int n : {256, 1000, 4000, 16000}) {
+    ParticleSystem reference, particles;
+    randomDisk(reference, n, 42);
+    randomDisk(particles, n, 42);
+    double pairs = 0.5 * n * (n - 1.0);
+
+    double tRef = timeSeconds([&] {
+      computeAccelerationsReference(reference, gravity, softening);
+    });
+    std::printf("%8d %10s %14.3e %10s %14s\n", n, "reference", pairs / tRef,
+                "1.00", "-");
+
+    for (SimdLevel level :
+         {SimdLevel::SCALAR, SimdLevel::AVX2, SimdLevel::AVX512}) {
+      if (level > best) {
+        continue;
+      }
+      double t = timeSeconds([&] {
+        computeAccelerations(particles, gravity, softening, level);
+      });
+      double err = 0;
+      for (int i = 0; i < n; i++) {
+        double ex = particles.ax[i] - reference.ax[i];
+        double ey = particles.ay[i] - reference.ay[i];
+        double norm = std::hypot(reference.ax[i], reference.ay[i]);
+        err = std::max(err, std::hypot(ex, ey) / norm);
+      }
+      std::printf("%8d %10s %14.3e %10.2f %14.2e\n", n, simdLevelName(level),
+                  pairs / t, tRef / t, err);
+    }
+  }
+  return 0;
+}
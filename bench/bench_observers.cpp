@@ -0,0 +1,72 @@
+// Cost per step and memory kept by the trajectory observers: the full
+// history, the latest state only, every 100th step, a ring buffer and the
+// binary file writer with synchronous and asynchronous flushing.
+#include <Problem.h>
+#include <Solver.h>
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+using State = Vector<double>;
+using Euler = ExplicitEuler<Linear_ODE, double>;
+
+const int dim = 1000;
+const int nSteps = 10000;
+
+Linear_ODE makeProblem() {
+  std::vector<double> r0_(dim, 1.0);
+  State r0(r0_);
+  return Linear_ODE(r0, 0, -0.1);
+}
+
+// integrates with the given observer attached, history off if observer set.
+// keptMB returns the memory held by the observer after the run
+template <typename Kept>
+void run(const char *label, Observer<State> *observer, Kept keptMB) {
+  Euler solver(makeProblem(), 1e-3, nSteps);
+  solver.setStoreHistory(observer == nullptr);
+  if (observer) {
+    solver.addObserver(*observer);
+  }
+  auto start = std::chrono::steady_clock::now();
+  solver.integrate();
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+  double kept = observer ? keptMB()
+                         : solver.getYn().size() * dim * sizeof(double) / 1e6;
+  std::printf("%-26s %14.2f %14.2f\n", label, 1e6 * seconds / nSteps, kept);
+}
+
+int main() {
+  spdlog::set_level(spdlog::level::warn);
+  std::printf("explicit Euler, dim %d, %d steps\n", dim, nSteps);
+  std::printf("%-26s %14s %14s\n", "observer", "us / step", "kept [MB]");
+  double stateMB = dim * sizeof(double) / 1e6;
+
+  run("history", nullptr, [] { return 0.0; });
+
+  KeepLast<State> last;
+  run("keep last", &last, [&] { return stateMB; });
+
+  History<State> sampled;
+  Decimate<State> every100(sampled, 100);
+  run("every 100th step", &every100,
+      [&] { return sampled.getR().size() * stateMB; });
+
+  RingBuffer<State> ring(64);
+  run("ring buffer of 64", &ring, [&] { return ring.capacity() * stateMB; });
+
+  // the writers hold one or two buffers of 1 MB
+  std::string path = "bench_observers.bin";
+  {
+    BinaryFileWriter<State> writer(path);
+    run("binary file, sync", &writer, [] { return 1.0; });
+  }
+  {
+    BinaryFileWriter<State> writer(path, true);
+    run("binary file, async", &writer, [] { return 2.0; });
+  }
+  std::remove(path.c_str());
+  return 0;
+}
@@ -0,0 +1,75 @@
+// Allocations and time per RK4 step, comparing the allocating operator based
+// step the solvers used before against the in-place workspace step.
+#include <Problem.h>
+#include <Solver.h>
+#include <SolverStats.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+ODE_SOLVER_COUNT_ALLOCATIONS
+
+// the RK4 step as it was written before the in-place API
+static Vector<double> legacyStep(Linear_ODE &problem, double t_i,
+                                 const Vector<double> &r_i, double dt) {
+  Vector<double> k1 = problem.eval(t_i, r_i);
+  Vector<double> k2 = problem.eval(t_i + dt / 2, r_i + (dt / 2) * k1);
+  Vector<double> k3 = problem.eval(t_i + dt / 2, r_i + (dt / 2) * k2);
+  Vector<double> k4 = problem.eval(t_i + dt, r_i + dt * k3);
+  return r_i + (dt / 6) * (k1 + k2 * 2 + k3 * 2 + k4);
+}
+
+class BenchRK4 : public RungeKutta4<Linear_ODE, double> {
+public:
+  using RungeKutta4<Linear_ODE, double>::RungeKutta4;
+  using RungeKutta4<Linear_ODE, double>::step;
+};
+
+int main() {
+  spdlog::set_level(spdlog::level::warn);
+  const int nSteps = 1000000;
+  const double dt = 1e-6;
+
+  std::printf("%6s %22s %16s %22s %16s\n", "dim", "legacy allocs/step",
+              "legacy ns/step", "in-place allocs/step", "in-place ns/step");
+  for (int dim : {1, 3, 16, 128}) {
+    std::vector<double> r0_(dim, 1.0);
+    Vector<double> r0(r0_);
+    Linear_ODE problem(r0, 0, -0.5);
+
+    Vector<double> r = r0;
+    double t = 0;
+    long allocs0 = threadAllocations;
+    auto start = std::chrono::steady_clock::now();
+    for (int n = 0; n < nSteps; n++) {
+      r = legacyStep(problem, t, r, dt);
+      t += dt;
+    }
+    auto stop = std::chrono::steady_clock::now();
+    double legacyAllocs = double(threadAllocations - allocs0) / nSteps;
+    double legacyNs =
+        std::chrono::duration<double, std::nano>(stop - start).count() /
+        nSteps;
+
+    BenchRK4 solver(problem, dt, nSteps);
+    solver.setStoreHistory(false);
+    allocs0 = threadAllocations;
+    start = std::chrono::steady_clock::now();
+    for (int n = 0; n < nSteps; n++) {
+      solver.step();
+    }
+    stop = std::chrono::steady_clock::now();
+    double inPlaceAllocs = double(threadAllocations - allocs0) / nSteps;
+    double inPlaceNs =
+        std::chrono::duration<double, std::nano>(stop - start).count() /
+        nSteps;
+
+    if (std::abs(solver.getR()[0] - r[0]) > 1e-9) {
+      std::printf("results differ: %f vs %f\n", solver.getR()[0], r[0]);
+      return 1;
+    }
+    std::printf("%6d %22.2f %16.1f %22.2f %16.1f\n", dim, legacyAllocs,
+                legacyNs, inPlaceAllocs, inPlaceNs);
+  }
+  return 0;
+}
@@ -0,0 +1,146 @@
+// Steps, cost and accuracy of the implicit solvers against RungeKutta4 on
+// stiff problems. RungeKutta4 is only stable for dt below about 2.8 / |lambda|
+// of the fastest mode, the implicit solvers take steps set by accuracy alone.
+#include <ImplicitSolver.h>
+#include <Problem.h>
+#include <Solver.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <type_traits>
+#include <utility>
+
+// Robertson's chemical kinetics, rates spanning nine orders of magnitude.
+// No analytic Jacobian, the solvers difference the dense one
+class Robertson : public ODE_Problem<double> {
+public:
+  Robertson() {
+    this->r_0 = StateType{1, 0, 0};
+    this->t_0 = 0;
+    this->dim = 3;
+  }
+  using ODE_Problem<double>::eval;
+  void eval(double t_i, const StateType &r_i, StateType &out) override {
+    double a = 0.04 * r_i[0], b = 1e4 * r_i[1] * r_i[2];
+    double c = 3e7 * r_i[1] * r_i[1];
+    out[0] = -a + b;
+    out[1] = a - b - c;
+    out[2] = c;
+  }
+};
+
+// the reaction diffusion problem without its Jacobian, differenced in three
+// evaluations thanks to the band
+class ReactionDiffusionFD : public ReactionDiffusion {
+public:
+  using ReactionDiffusion::ReactionDiffusion;
+  bool jacobian(double t_i, const StateType &r_i, Matrix &J) override {
+    return false;
+  }
+};
+
+template <typename P, typename SolverType>
+double run(SolverType solver, double tEnd, const char *label, double dt,
+           const Vector<double> &reference) {
+  solver.setStoreHistory(false);
+  solver.setEndTime(tEnd);
+  auto start = std::chrono::steady_clock::now();
+  solver.integrate();
+  double ms = std::chrono::duration<double, std::milli>(
+                  std::chrono::steady_clock::now() - start)
+                  .count();
+  // an unstable run ends in inf or nan, which std::max would drop
+  double err = 0;
+  for (int j = 0; j < reference.getDim(); j++) {
+    double e = std::abs(solver.getR()[j] - reference[j]);
+    if (!(e <= err)) {
+      err = e;
+    }
+  }
+  long jacobians = -1, factorizations = -1;
+  if constexpr (std::is_base_of_v<ImplicitSolver<P, double>, SolverType>) {
+    jacobians = solver.getJacobianEvaluations();
+    factorizations = solver.getFactorizations();
+  }
+  std::printf("%-16s %9.1e %9d %9d %10ld %6ld %6ld %10.2f %12.3e\n", label,
+              dt, solver.getSteps(), solver.getRejectedSteps(),
+              solver.getRhsEvaluations(), jacobians, factorizations, ms, err);
+  return err;
+}
+
+template <typename P>
+void suite(const char *title, const P &problem, double tEnd,
+           std::initializer_list<double> explicitSteps,
+           std::initializer_list<double> implicitSteps, double referenceDt) {
+  const int maxI = 100000000;
+  RungeKutta4<P, double> reference(problem, referenceDt, maxI);
+  reference.setStoreHistory(false);
+  reference.setEndTime(tEnd);
+  reference.integrate();
+  Vector<double> r = reference.getR();
+
+  std::printf("\n%s on [0, %g], reference RungeKutta4 with dt %g\n", title,
+              tEnd, referenceDt);
+  std::printf("%-16s %9s %9s %9s %10s %6s %6s %10s %12s\n", "solver", "dt",
+              "steps", "rejected", "rhs evals", "jac", "lu", "time [ms]",
+              "max error");
+  for (double dt : explicitSteps) {
+    run<P>(RungeKutta4<P, double>(problem, dt, maxI), tEnd, "RungeKutta4", dt, r);
+  }
+  for (double dt : implicitSteps) {
+    run<P>(BackwardEuler<P, double>(problem, dt, maxI), tEnd, "BackwardEuler", dt,
+        r);
+    run<P>(BDF2<P, double>(problem, dt, maxI), tEnd, "BDF2", dt, r);
+    run<P>(SDIRK2<P, double>(problem, dt, maxI), tEnd, "SDIRK2", dt, r);
+  }
+}
+
+// Observed order of the second order solvers from the errors at dt and dt / 2
+// on [0, tEnd]. A Newton iteration stopped short of convergence leaves an
+// error that does not shrink with dt and shows up as a falling order
+template <typename P>
+bool checkOrder(const char *title, const P &problem, double tEnd,
+                double dt, double referenceDt) {
+  const int maxI = 100000000;
+  RungeKutta4<P, double> reference(problem, referenceDt, maxI);
+  reference.setStoreHistory(false);
+  reference.setEndTime(tEnd);
+  reference.integrate();
+  Vector<double> r = reference.getR();
+
+  std::printf("\nOrder on %s, [0, %g]\n", title, tEnd);
+  std::printf("%-16s %9s %9s %9s %10s %6s %6s %10s %12s\n", "solver", "dt",
+              "steps", "rejected", "rhs evals", "jac", "lu", "time [ms]",
+              "max error");
+  double bdf2[2], sdirk2[2];
+  for (int i = 0; i < 2; i++) {
+    double h = dt / (1 << i);
+    bdf2[i] = run<P>(BDF2<P, double>(problem, h, maxI), tEnd, "BDF2", h, r);
+    sdirk2[i] =
+        run<P>(SDIRK2<P, double>(problem, h, maxI), tEnd, "SDIRK2", h, r);
+  }
+  bool ok = true;
+  for (auto [label, err] : {std::pair{"BDF2", bdf2}, {"SDIRK2", sdirk2}}) {
+    double order = std::log2(err[0] / err[1]);
+    std::printf("%-16s observed order %.2f\n", label, order);
+    if (!(order > 1.8)) {
+      std::printf("%s: expected second order\n", label);
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+int main() {
+  spdlog::set_level(spdlog::level::off);
+  std::printf("jac / lu: Jacobian evaluations and LU factorizations\n");
+  suite("Robertson", Robertson(), 40, {3e-4, 2e-4}, {1e-1, 1e-2}, 1e-5);
+  suite("Reaction diffusion, 200 points", ReactionDiffusion(200), 0.2,
+        {2e-5, 1e-5}, {1e-2, 1e-3}, 2e-6);
+  suite("Same, finite difference Jacobian", ReactionDiffusionFD(200), 0.2, {},
+        {1e-3}, 2e-6);
+  if (!checkOrder("Robertson", Robertson(), 1, 1e-2, 1e-5)) {
+    return 1;
+  }
+  return 0;
+}
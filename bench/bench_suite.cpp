@@ -0,0 +1,203 @@
+// Benchmark suite for tracking performance across releases: every solver on
+// Linear_ODE, the Lorenz attractor and N_Body at several sizes, one record
+// per run with its SolverStats, written as csv (default) or json.
+//   bench_suite [--format csv|json] [--output file]
+// The split into eval, update and output time needs a build with
+// ENABLE_SOLVER_TIMING, the columns are 0 otherwise. Allocations are only
+// counted with ENABLE_SOLVER_STATS, n/a in csv and null in json otherwise.
+#include <Ensemble.h>
+#include <ImplicitSolver.h>
+#include <Problem.h>
+#include <Solver.h>
+#include <SolverStats.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+ODE_SOLVER_COUNT_ALLOCATIONS
+
+// the allocation count of a record as text, n/a or null if none was taken
+static std::string allocations(const SolverStats &stats, const char *none) {
+  return allocationsCounted() ? std::to_string(stats.allocations) : none;
+}
+
+struct Record {
+  std::string problem;
+  int size;
+  int dim;
+  std::string solver;
+  double dt;
+  double tEnd;
+  int steps;
+  double seconds;
+  SolverStats stats;
+};
+
+template <typename SolverType>
+void run(std::vector<Record> &records, const char *problem, int size,
+         SolverType solver, double dt, double tEnd) {
+  solver.setStoreHistory(false);
+  solver.setEndTime(tEnd);
+  solver.resetStats();
+  auto start = std::chrono::steady_clock::now();
+  solver.integrate();
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+  records.push_back({problem, size, solver.getR().getDim(), solver.getName(),
+                     dt, tEnd, solver.getSteps(), seconds,
+                     solver.getStats()});
+}
+
+// the solvers for states of doubles, the implicit ones need a banded or a
+// small Jacobian to be affordable
+template <typename P>
+void suite(std::vector<Record> &records, const char *name, int size,
+           const P &problem, double dt, double tEnd) {
+  const int maxI = 100000000;
+  run(records, name, size, ExplicitEuler<P, double>(problem, dt, maxI), dt,
+      tEnd);
+  run(records, name, size, RungeKutta4<P, double>(problem, dt, maxI), dt,
+      tEnd);
+  run(records, name, size, DormandPrince54<P, double>(problem, dt, maxI), dt,
+      tEnd);
+  if (problem.jacobianLowerBandwidth() < 0 && problem.r_0.getDim() > 64) {
+    return;
+  }
+  run(records, name, size, BackwardEuler<P, double>(problem, dt, maxI), dt,
+      tEnd);
+  run(records, name, size, BDF2<P, double>(problem, dt, maxI), dt, tEnd);
+  run(records, name, size, SDIRK2<P, double>(problem, dt, maxI), dt, tEnd);
+}
+
+static Vector<Body> randomDisk(int n, unsigned seed) {
+  std::mt19937 gen(seed);
+  std::uniform_real_distribution<double> uniform(0, 1);
+  Vector<Body> bodies(n);
+  for (int i = 0; i < n; i++) {
+    double r = std::sqrt(uniform(gen)), phi = 2 * M_PI * uniform(gen);
+    bodies[i] = Body(1.0 / n, r * std::cos(phi), r * std::sin(phi),
+                     -r * std::sin(phi), r * std::cos(phi));
+    bodies[i].objectID = i;
+  }
+  return bodies;
+}
+
+static void writeCsv(std::FILE *out, const std::vector<Record> &records) {
+  std::fprintf(out, "problem,size,dim,solver,dt,t_end,steps,accepted,"
+                    "rejected,rhs_evaluations,allocations,seconds,"
+                    "ns_per_step,eval_seconds,update_seconds,"
+                    "output_seconds\n");
+  for (const Record &r : records) {
+    std::fprintf(out, "%s,%d,%d,%s,%g,%g,%d,%ld,%ld,%ld,%s,%.6e,%.1f,%.6e,"
+                      "%.6e,%.6e\n",
+                 r.problem.c_str(), r.size, r.dim, r.solver.c_str(), r.dt,
+                 r.tEnd, r.steps, r.stats.acceptedSteps,
+                 r.stats.rejectedSteps, r.stats.rhsEvaluations,
+                 allocations(r.stats, "n/a").c_str(), r.seconds,
+                 1e9 * r.seconds / std::max(r.steps, 1), r.stats.evalTime,
+                 r.stats.updateTime, r.stats.outputTime);
+  }
+}
+
+static void writeJson(std::FILE *out, const std::vector<Record> &records) {
+  std::fprintf(out,
+               "{\n  \"stats\": %s,\n  \"timing\": %s,\n"
+               "  \"allocation_counting\": %s,\n",
+               solverStatsEnabled ? "true" : "false",
+               solverTimingEnabled ? "true" : "false",
+               allocationsCounted() ? "true" : "false");
+  std::fprintf(out, "  \"results\": [\n");
+  for (std::size_t k = 0; k < records.size(); k++) {
+    const Record &r = records[k];
+    std::fprintf(
+        out,
+        "    {\"problem\": \"%s\", \"size\": %d, \"dim\": %d, "
+        "\"solver\": \"%s\", \"dt\": %g, \"t_end\": %g, \"steps\": %d, "
+        "\"accepted\": %ld, \"rejected\": %ld, \"rhs_evaluations\": %ld, "
+        "\"allocations\": %s, \"seconds\": %.6e, \"ns_per_step\": %.1f, "
+        "\"eval_seconds\": %.6e, \"update_seconds\": %.6e, "
+        "\"output_seconds\": %.6e}%s\n",
+        r.problem.c_str(), r.size, r.dim, r.solver.c_str(), r.dt, r.tEnd,
+        r.steps, r.stats.acceptedSteps, r.stats.rejectedSteps,
+        r.stats.rhsEvaluations, allocations(r.stats, "null").c_str(),
+        r.seconds, 1e9 * r.seconds / std::max(r.steps, 1), r.stats.evalTime,
+        r.stats.updateTime, r.stats.outputTime,
+        k + 1 < records.size() ? "," : "");
+  }
+  std::fprintf(out, "  ]\n}\n");
+}
+
+int main(int argc, char **argv) {
+  spdlog::set_level(spdlog::level::warn);
+  std::string format = "csv";
+  const char *path = nullptr;
+  for (int k = 1; k + 1 < argc; k += 2) {
+    if (std::strcmp(argv[k], "--format") == 0) {
+      format = argv[k + 1];
+    } else if (std::strcmp(argv[k], "--output") == 0) {
+      path = argv[k + 1];
+    }
+  }
+  if (format != "csv" && format != "json") {
+    std::fprintf(stderr, "unknown format %s, use csv or json\n",
+                 format.c_str());
+    return 1;
+  }
+
+  std::vector<Record> records;
+  for (int n : {1, 64, 4096}) {
+    Vector<double> r0(n);
+    for (int j = 0; j < n; j++) {
+      r0[j] = 1 + j % 7;
+    }
+    suite(records, "linear", n, Linear_ODE(r0, 0, -0.5), 1e-3, 10);
+  }
+
+  Vector<double, 3> lorenz0{1, 1, 1};
+  LorenzAttractor lorenz(lorenz0, 0);
+  suite(records, "lorenz", 1, lorenz, 1e-3, 10);
+  for (int n : {16, 256}) {
+    std::vector<Vector<double, 3>> initial(n, lorenz0);
+    for (int j = 0; j < n; j++) {
+      initial[j][0] += 1e-3 * j;
+    }
+    suite(records, "lorenz", n,
+          Ensemble<LorenzAttractor>(lorenz, initial), 1e-3, 10);
+  }
+
+  for (int n : {16, 64, 256}) {
+    Vector<Body> bodies = randomDisk(n, 42);
+    N_Body problem(bodies, 0, 1);
+    problem.setSoftening(1e-2);
+    const int maxI = 100000000;
+    const double dt = 1e-3, tEnd = 0.1;
+    run(records, "nbody", n, ExplicitEuler<N_Body, Body>(problem, dt, maxI),
+        dt, tEnd);
+    run(records, "nbody", n, RungeKutta4<N_Body, Body>(problem, dt, maxI), dt,
+        tEnd);
+    run(records, "nbody", n, Leapfrog<N_Body, Body>(problem, dt, maxI), dt,
+        tEnd);
+    run(records, "nbody", n, Leapfrog<N_Body, Body>(problem, dt, maxI, 4),
+        dt, tEnd);
+  }
+
+  std::FILE *out = path ? std::fopen(path, "w") : stdout;
+  if (!out) {
+    std::fprintf(stderr, "cannot open %s\n", path);
+    return 1;
+  }
+  if (format == "json") {
+    writeJson(out, records);
+  } else {
+    writeCsv(out, records);
+  }
+  if (path) {
+    std::fclose(out);
+  }
+  return 0;
+}
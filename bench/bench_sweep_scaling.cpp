@@ -0,0 +1,91 @@
+// Strong scaling of parallelSweep: a fixed set of adaptive step integrations
+// of very uneven cost (Linear_ODE over a range of lambda, Lorenz over initial
+// conditions) run on 1 up to all cores.
+#include <Problem.h>
+#include <Solver.h>
+#include <Sweep.h>
+#include <chrono>
+#include <cstdio>
+#include <stdexcept>
+
+template <typename Factory>
+double timeSweep(int nTasks, Factory makeSolver, int nThreads,
+                 long &rhsEvaluations) {
+  auto start = std::chrono::steady_clock::now();
+  auto results = parallelSweep(nTasks, makeSolver, nThreads);
+  auto stop = std::chrono::steady_clock::now();
+  rhsEvaluations = 0;
+  for (auto &result : results) {
+    rhsEvaluations += result.stats.rhsEvaluations;
+  }
+  return std::chrono::duration<double>(stop - start).count();
+}
+
+int main() {
+  spdlog::set_level(spdlog::level::warn);
+  int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<int> threadCounts;
+  for (int n = 1; n < maxThreads; n *= 2) {
+    threadCounts.push_back(n);
+  }
+  threadCounts.push_back(maxThreads);
+
+  std::vector<double> r0_ = {1};
+  Vector<double> r0(r0_);
+  Linear_ODE linear(r0, 0, 0);
+  const int nLinear = 2000;
+  auto makeLinear = [&](int k) {
+    Linear_ODE p = linear;
+    p.lambda = -50.0 * k / nLinear;
+    DormandPrince54<Linear_ODE, double> solver(p, 0, 10000000, 1e-10,
+                                               1e-10);
+    solver.setEndTime(20);
+    return solver;
+  };
+
+  Vector<double, 3> lorenz0 = {1, 1, 1};
+  LorenzAttractor lorenz(lorenz0, 0);
+  const int nLorenz = 200;
+  auto makeLorenz = [&](int k) {
+    LorenzAttractor p = lorenz;
+    p.r_0 = {1 + 0.01 * k, 1, 1.0 + k % 7};
+    DormandPrince54<LorenzAttractor, double> solver(p, 0, 10000000, 1e-10,
+                                                    1e-10);
+    solver.setEndTime(5 + k % 10);
+    return solver;
+  };
+
+  std::printf("%-10s %8s %12s %10s %12s %14s\n", "sweep", "threads",
+              "time [s]", "speedup", "efficiency", "rhs evals");
+  double base = 0;
+  for (int n : threadCounts) {
+    long evals;
+    double t = timeSweep(nLinear, makeLinear, n, evals);
+    base = n == 1 ? t : base;
+    std::printf("%-10s %8d %12.4f %10.2f %12.2f %14ld\n", "Linear_ODE", n, t,
+                base / t, base / t / n, evals);
+  }
+  for (int n : threadCounts) {
+    long evals;
+    double t = timeSweep(nLorenz, makeLorenz, n, evals);
+    base = n == 1 ? t : base;
+    std::printf("%-10s %8d %12.4f %10.2f %12.2f %14ld\n", "Lorenz", n, t,
+                base / t, base / t / n, evals);
+  }
+
+  // a failing task must reach the caller instead of terminating the program
+  auto makeFailing = [&](int k) {
+    if (k == 3) {
+      throw std::runtime_error("no solver for task 3");
+    }
+    return makeLinear(k);
+  };
+  try {
+    parallelSweep(8, makeFailing, 2);
+    std::printf("exception of a sweep task was lost\n");
+    return 1;
+  } catch (const std::runtime_error &e) {
+    std::printf("\nexception of a sweep task: %s\n", e.what());
+  }
+  return 0;
+}
@@ -0,0 +1,176 @@
+// Writing a trajectory as text lines built with toStr against the binary
+// trajectory format, random access by time through the memory mapped
+// reader, and a restart from a stored state.
+#include <Problem.h>
+#include <Solver.h>
+#include <Trajectory.h>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <string>
+
+using State = Vector<double>;
+using RK4 = RungeKutta4<Linear_ODE, double>;
+
+const int dim = 256;
+const int nSteps = 5000;
+const double dt = 1e-3;
+
+Linear_ODE makeProblem() {
+  std::vector<double> r0_(dim);
+  for (int j = 0; j < dim; j++) {
+    r0_[j] = 1 + j;
+  }
+  State r0(r0_);
+  return Linear_ODE(r0, 0, -0.5);
+}
+
+// the text output of the solvers' print mode, written to a file
+class TextWriter : public Observer<State> {
+public:
+  TextWriter(const std::string &path) : file(std::fopen(path.c_str(), "w")){};
+  ~TextWriter() { std::fclose(file); };
+  void observe(int step, double t, const State &r) override {
+    std::string line = "\t" + std::to_string(step) + "\t\t" +
+                       std::to_string(t) + "\t\t" + r.toStr() + "\n";
+    std::fputs(line.c_str(), file);
+  };
+
+private:
+  std::FILE *file;
+};
+
+template <typename F> double timeMs(F f) {
+  auto start = std::chrono::steady_clock::now();
+  f();
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+double writeWith(Observer<State> &observer) {
+  RK4 solver(makeProblem(), dt, nSteps);
+  solver.setStoreHistory(false);
+  solver.addObserver(observer);
+  return timeMs([&] { solver.integrate(); });
+}
+
+long fileSize(const std::string &path) {
+  std::FILE *f = std::fopen(path.c_str(), "rb");
+  std::fseek(f, 0, SEEK_END);
+  long size = std::ftell(f);
+  std::fclose(f);
+  return size;
+}
+
+int main() {
+  spdlog::set_level(spdlog::level::warn);
+  std::string text = "bench_trajectory.txt", binary = "bench_trajectory.traj";
+  std::printf("RungeKutta4, dim %d, %d steps\n", dim, nSteps);
+  std::printf("%-24s %12s %12s\n", "output", "write [ms]", "size [MB]");
+
+  double ms;
+  {
+    TextWriter writer(text);
+    ms = writeWith(writer);
+  }
+  std::printf("%-24s %12.1f %12.1f\n", "text, toStr", ms, fileSize(text) / 1e6);
+  for (bool async : {false, true}) {
+    {
+      TrajectoryWriter<State> writer(binary, "Runge Kutta 4", "", async);
+      ms = writeWith(writer);
+    }
+    std::printf("%-24s %12.1f %12.1f\n",
+                async ? "binary, async" : "binary, sync", ms,
+                fileSize(binary) / 1e6);
+  }
+
+  // random lookups by time, each reads one component of the found state
+  TrajectoryReader reader(binary);
+  std::mt19937 gen(1);
+  std::uniform_real_distribution<double> uniform(0, nSteps * dt);
+  const int nLookups = 100000;
+  double sum = 0;
+  ms = timeMs([&] {
+    for (int k = 0; k < nLookups; k++) {
+      long record = reader.find(uniform(gen));
+      sum += reader.getState<double>(record)[k % dim];
+    }
+  });
+  std::printf("\n%d lookups by time: %.1f ns each (checksum %g)\n", nLookups,
+              1e6 * ms / nLookups, sum);
+
+  // restart from the middle of the run, the continuation has to reproduce
+  // the uninterrupted run exactly
+  RK4 full(makeProblem(), dt, nSteps);
+  full.setStoreHistory(false);
+  full.integrate();
+
+  long middle = reader.find(0.5 * nSteps * dt);
+  Linear_ODE problem = makeProblem();
+  State r(dim);
+  reader.loadState(middle, r);
+  problem.init(reader.getT(middle), r);
+  RK4 restarted(problem, dt, nSteps - middle);
+  restarted.setStoreHistory(false);
+  restarted.integrate();
+  double diff = 0;
+  for (int j = 0; j < dim; j++) {
+    diff = std::max(diff, std::abs(restarted.getR()[j] - full.getR()[j]));
+  }
+  std::printf("restart from t = %g: max difference to the full run %g\n",
+              reader.getT(middle), diff);
+
+  // a closed file cut short in the middle of the records is read like an
+  // unfinished one: no index, only the records that are there entirely
+  std::string truncated = "bench_trajectory_truncated.traj";
+  std::filesystem::copy_file(binary, truncated,
+                             std::filesystem::copy_options::overwrite_existing);
+  long keep = reader.size() / 2;
+  long recordSize = reader.getHeader().recordSize;
+  std::filesystem::resize_file(truncated, sizeof(TrajectoryHeader) +
+                                              keep * recordSize +
+                                              recordSize / 2);
+  bool ok;
+  {
+    TrajectoryReader cut(truncated);
+    long last = cut.size() - 1;
+    ok = !cut.isComplete() && cut.size() == keep &&
+         cut.getT(last) == reader.getT(last) &&
+         cut.find(nSteps * dt) == last;
+    std::printf("file cut after %ld records: %ld records read, last t = %g\n",
+                keep, cut.size(), cut.getT(last));
+  }
+
+  // a state observed after close is dropped, the file stays complete
+  std::string late = "bench_trajectory_late.traj";
+  bool lateOk;
+  {
+    TrajectoryWriter<State> writer(late);
+    State r(dim);
+    writer.observe(0, 0, r);
+    writer.close();
+    spdlog::set_level(spdlog::level::err);
+    writer.observe(1, dt, r);
+    spdlog::set_level(spdlog::level::warn);
+  }
+  {
+    TrajectoryReader closed(late);
+    lateOk = closed.isComplete() && closed.size() == 1;
+  }
+
+  std::remove(text.c_str());
+  std::remove(binary.c_str());
+  std::remove(truncated.c_str());
+  std::remove(late.c_str());
+  if (!ok) {
+    std::printf("truncated file read beyond its records\n");
+    return 1;
+  }
+  if (!lateOk) {
+    std::printf("a state observed after close corrupted the file\n");
+    return 1;
+  }
+  return 0;
+}
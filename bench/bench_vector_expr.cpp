@@ -0,0 +1,70 @@
+// Time of the RK4 stage combination r + (h/6) * (k1 + 2 k2 + 2 k3 + k4) over
+// state dimensions, evaluated eagerly with one temporary per operator (as
+// Vector did before expression templates) versus fused into one loop.
+#include <Vector.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+typedef std::vector<double> vec;
+
+static vec eagerAdd(const vec &a, const vec &b) {
+  vec res(a.size());
+  for (size_t i = 0; i < a.size(); i++) {
+    res[i] = a[i] + b[i];
+  }
+  return res;
+}
+
+static vec eagerScale(const vec &a, double s) {
+  vec res(a.size());
+  for (size_t i = 0; i < a.size(); i++) {
+    res[i] = a[i] * s;
+  }
+  return res;
+}
+
+int main() {
+  const double h = 1e-3;
+  std::printf("%10s %14s %14s %10s\n", "dim", "eager ns/elem", "fused ns/elem",
+              "speedup");
+  for (int dim : {1000, 10000, 100000, 1000000}) {
+    std::vector<double> init(dim);
+    for (int i = 0; i < dim; i++) {
+      init[i] = std::sin(i);
+    }
+    Vector<double> r(init), k1(init), k2(init), k3(init), k4(init);
+    vec er(init), ek1(init), ek2(init), ek3(init), ek4(init);
+
+    int reps = std::max(10, 100000000 / dim);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int n = 0; n < reps; n++) {
+      er = eagerAdd(er, eagerScale(eagerAdd(eagerAdd(eagerAdd(ek1,
+                                     eagerScale(ek2, 2)), eagerScale(ek3, 2)),
+                                     ek4), h / 6));
+    }
+    auto stop = std::chrono::steady_clock::now();
+    double eagerNs =
+        std::chrono::duration<double, std::nano>(stop - start).count() /
+        (double(reps) * dim);
+
+    start = std::chrono::steady_clock::now();
+    for (int n = 0; n < reps; n++) {
+      r = r + (h / 6) * (k1 + k2 * 2 + k3 * 2 + k4);
+    }
+    stop = std::chrono::steady_clock::now();
+    double fusedNs =
+        std::chrono::duration<double, std::nano>(stop - start).count() /
+        (double(reps) * dim);
+
+    if (std::abs(r[dim - 1] - er[dim - 1]) > 1e-6 * std::abs(er[dim - 1])) {
+      std::printf("results differ: %f vs %f\n", r[dim - 1], er[dim - 1]);
+      return 1;
+    }
+    std::printf("%10d %14.3f %14.3f %9.1fx\n", dim, eagerNs, fusedNs,
+                eagerNs / fusedNs);
+  }
+  return 0;
+}
@@ -0,0 +1,75 @@
+// Work-precision comparison of the fixed step RungeKutta4 and the adaptive
+// DormandPrince54: error at the end time against right hand side evaluations.
+#include <Problem.h>
+#include <Solver.h>
+#include <cmath>
+#include <cstdio>
+
+// y' = -k (y - cos t), a fast transient onto a slowly varying solution
+class Transient : public ODE_Problem<double, 1> {
+public:
+  Transient(double k_ = 1) : k(k_) {
+    this->r_0 = StateType{0};
+    this->t_0 = 0;
+  }
+  using ODE_Problem<double, 1>::eval;
+  void eval(double t_i, const StateType &r_i, StateType &out) override {
+    out[0] = -k * (r_i[0] - std::cos(t_i));
+  }
+  double exact(double t) const {
+    double a = k * k / (k * k + 1), b = k / (k * k + 1);
+    return a * std::cos(t) + b * std::sin(t) - a * std::exp(-k * t);
+  }
+  double k;
+};
+
+template <typename SolverType>
+void run(SolverType &solver, double tEnd, const char *label, double param,
+         double exact) {
+  solver.setStoreHistory(false);
+  solver.setEndTime(tEnd);
+  solver.solve();
+  std::printf("%-22s %10.0e %14ld %10d %14.3e\n", label, param,
+              solver.getRhsEvaluations(), solver.getRejectedSteps(),
+              std::abs(solver.getR()[0] - exact));
+}
+
+int main() {
+  spdlog::set_level(spdlog::level::warn);
+  const double tEnd = 10;
+  const int maxI = 100000000;
+
+  Transient problem(200);
+  double exact = problem.exact(tEnd);
+  std::printf("y' = -%g (y - cos t) on [0, %g]\n", problem.k, tEnd);
+  std::printf("%-22s %10s %14s %10s %14s\n", "solver", "dt / tol",
+              "rhs evals", "rejected", "error");
+  for (double dt : {1e-2, 5e-3, 2e-3, 1e-3, 1e-4}) {
+    RungeKutta4<Transient, double> rk4(problem, dt, maxI);
+    run(rk4, tEnd, "RungeKutta4", dt, exact);
+  }
+  for (double tol : {1e-3, 1e-5, 1e-7, 1e-9, 1e-11}) {
+    DormandPrince54<Transient, double> dp(problem, 0, maxI, tol, tol);
+    run(dp, tEnd, "DormandPrince54", tol, exact);
+  }
+
+  std::vector<double> r0_ = {1, 1, 1};
+  Vector<double, 3> r0(r0_);
+  LorenzAttractor lorenz(r0, 0);
+  DormandPrince54<LorenzAttractor, double> reference(lorenz, 0, maxI, 1e-13,
+                                                     1e-13);
+  reference.setStoreHistory(false);
+  reference.setEndTime(2);
+  reference.solve();
+  double lorenzExact = reference.getR()[0];
+  std::printf("\nLorenz attractor on [0, 2]\n");
+  for (double dt : {1e-2, 5e-3, 1e-3, 1e-4}) {
+    RungeKutta4<LorenzAttractor, double> rk4(lorenz, dt, maxI);
+    run(rk4, 2, "RungeKutta4", dt, lorenzExact);
+  }
+  for (double tol : {1e-4, 1e-6, 1e-8, 1e-10}) {
+    DormandPrince54<LorenzAttractor, double> dp(lorenz, 0, maxI, tol, tol);
+    run(dp, 2, "DormandPrince54", tol, lorenzExact);
+  }
+  return 0;
+}
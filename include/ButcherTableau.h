@@ -0,0 +1,65 @@
+#pragma once
+
+// Butcher tableaus of explicit Runge-Kutta methods for ExplicitRungeKutta in
+// Solver.h. Stage i is evaluated at t + c_i h and r + h sum_j a_ij k_j, the
+// step adds h sum_i b_i k_i. Everything is constexpr, so the solver unrolls
+// the stages and drops the zero coefficients at compile time. a is strictly
+// lower triangular and c_0 = 0.
+
+struct EulerTableau {
+  static constexpr int stages = 1;
+  static constexpr double a[1][1] = {{0}};
+  static constexpr double b[1] = {1};
+  static constexpr double c[1] = {0};
+  static constexpr const char *name = "Explicit Euler";
+};
+
+// explicit midpoint rule, second order
+struct MidpointTableau {
+  static constexpr int stages = 2;
+  static constexpr double a[2][2] = {{0, 0}, {0.5, 0}};
+  static constexpr double b[2] = {0, 1};
+  static constexpr double c[2] = {0, 0.5};
+  static constexpr const char *name = "Midpoint";
+};
+
+// trapezoidal predictor corrector, second order
+struct HeunTableau {
+  static constexpr int stages = 2;
+  static constexpr double a[2][2] = {{0, 0}, {1, 0}};
+  static constexpr double b[2] = {0.5, 0.5};
+  static constexpr double c[2] = {0, 1};
+  static constexpr const char *name = "Heun";
+};
+
+// Kutta's third order method
+struct Kutta3Tableau {
+  static constexpr int stages = 3;
+  static constexpr double a[3][3] = {{0, 0, 0}, {0.5, 0, 0}, {-1, 2, 0}};
+  static constexpr double b[3] = {1.0 / 6, 2.0 / 3, 1.0 / 6};
+  static constexpr double c[3] = {0, 0.5, 1};
+  static constexpr const char *name = "Kutta 3";
+};
+
+// the classical fourth order method
+struct RungeKutta4Tableau {
+  static constexpr int stages = 4;
+  static constexpr double a[4][4] = {
+      {0, 0, 0, 0}, {0.5, 0, 0, 0}, {0, 0.5, 0, 0}, {0, 0, 1, 0}};
+  static constexpr double b[4] = {1.0 / 6, 1.0 / 3, 1.0 / 3, 1.0 / 6};
+  static constexpr double c[4] = {0, 0.5, 0.5, 1};
+  static constexpr const char *name = "Runge Kutta 4";
+};
+
+// Kutta's 3/8 rule, fourth order with a smaller error constant than the
+// classical method
+struct RungeKutta38Tableau {
+  static constexpr int stages = 4;
+  static constexpr double a[4][4] = {{0, 0, 0, 0},
+                                     {1.0 / 3, 0, 0, 0},
+                                     {-1.0 / 3, 1, 0, 0},
+                                     {1, -1, 1, 0}};
+  static constexpr double b[4] = {1.0 / 8, 3.0 / 8, 3.0 / 8, 1.0 / 8};
+  static constexpr double c[4] = {0, 1.0 / 3, 2.0 / 3, 1};
+  static constexpr const char *name = "Runge Kutta 3/8";
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "Problem.h"
+#include <vector>
+
+// Lockstep ensemble of trajectories of one problem. The states of all
+// trajectories form a single structure of arrays state vector, component c of
+// trajectory j is stored at c * nTrajectories + j, and f is evaluated through
+// the problem's evalEnsemble hook. Since the ensemble is an ODE_Problem itself,
+// every solver integrates it, e.g. RungeKutta4<Ensemble<LorenzAttractor>,
+// double>, and its stage updates run as one vectorisable loop over all
+// trajectories.
+template <typename ProblemType>
+class Ensemble : public ODE_Problem<typename ProblemType::ValueType> {
+public:
+  using ValueType = typename ProblemType::ValueType;
+  using StateType = Vector<ValueType>;
+  using TrajectoryType = typename ProblemType::StateType;
+
+  Ensemble(){};
+  Ensemble(const ProblemType &problem_,
+           const std::vector<TrajectoryType> &initialStates)
+      : problem(problem_), nTrajectories(initialStates.size()) {
+    this->stateDim = nTrajectories > 0 ? initialStates[0].getDim() : 0;
+    this->t_0 = problem.t_0;
+    this->dim = this->stateDim;
+    this->nParticles = nTrajectories;
+    this->r_0.resize(this->stateDim * nTrajectories);
+    for (int j = 0; j < nTrajectories; j++) {
+      assert(initialStates[j].getDim() == this->stateDim);
+      for (int c = 0; c < this->stateDim; c++) {
+        this->r_0[c * nTrajectories + j] = initialStates[j][c];
+      }
+    }
+  };
+
+  using ODE_Problem<ValueType>::eval;
+  void eval(double t_i, const StateType &r_i, StateType &out) override {
+    problem.evalEnsemble(t_i, stateDim, nTrajectories, &r_i[0], &out[0]);
+  };
+  StateType eval(double t_i, const StateType &r_i) override {
+    StateType r_j(r_i.getDim());
+    eval(t_i, r_i, r_j);
+    return r_j;
+  };
+
+  // extracts trajectory j from an ensemble state
+  TrajectoryType trajectory(const StateType &r, int j) const {
+    TrajectoryType r_j(stateDim);
+    for (int c = 0; c < stateDim; c++) {
+      r_j[c] = r[c * nTrajectories + j];
+    }
+    return r_j;
+  };
+
+  int size() const { return nTrajectories; };
+
+  ProblemType problem;
+  int nTrajectories = 0;
+  int stateDim = 0;
+};
@@ -0,0 +1,344 @@
+#pragma once
+
+#include "Matrix.h"
+#include "Solver.h"
+#include <cmath>
+#include <limits>
+#include <type_traits>
+
+// Common part of the implicit solvers for stiff problems. Every stage solves
+//   Y = psi + gammaH f(t, Y)
+// by a simplified Newton iteration with the matrix I - gammaH J. J is taken
+// from the problem or by finite differences and is kept, like the LU
+// factorization, across steps and stages as long as Newton converges fast.
+// It is recomputed once convergence slows down or fails, the factorization
+// whenever gammaH changes. If Newton fails with a fresh Jacobian the step
+// size is halved and the step counts as rejected, accepted steps double it
+// again up to the requested dt.
+//
+// Newton stops once the remaining error, estimated from the contraction
+// rate theta as theta / (1 - theta) |delta| (Hairer & Wanner, IV.8), is
+// below kappa in the rms norm weighted per component by atol + rtol |Y|.
+template <typename ProblemType, typename DataType>
+class ImplicitSolver : public Solver<ProblemType, DataType> {
+public:
+  using StateType = typename Solver<ProblemType, DataType>::StateType;
+  static_assert(std::is_same_v<typename ProblemType::ValueType, double>,
+                "the implicit solvers need a state of doubles");
+
+  ImplicitSolver(){};
+  ImplicitSolver(const ProblemType &problem, double dt_, int maxIteration_)
+      : Solver<ProblemType, DataType>(problem) {
+    this->dt = dt_;
+    this->init(this->problemDefintion.t_0, this->problemDefintion.r_0);
+    this->maxI = maxIteration_;
+    nominalDt = dt_;
+
+    int dim = this->r_i.getDim();
+    for (StateType *v : {&f, &residual, &rPerturbed, &fPerturbed}) {
+      v->resize(dim);
+    }
+    J.resize(dim, this->problemDefintion.jacobianLowerBandwidth(),
+             this->problemDefintion.jacobianUpperBandwidth());
+    lu = J;
+  };
+
+  // tolerance of the stage equations, atol + rtol |Y| per component
+  void setNewtonTolerance(double rtol, double atol) {
+    newtonRtol = rtol;
+    newtonAtol = atol;
+  };
+  long getJacobianEvaluations() const { return this->nJacobians; };
+  long getFactorizations() const { return this->nFactorizations; };
+
+protected:
+  // solves the stage equation for Y, starting from the value passed in Y
+  bool solveStage(double t, const StateType &psi, double gammaH,
+                  StateType &Y) {
+    for (int attempt = 0; attempt < 2; attempt++) {
+      if (jacobianStale) {
+        updateJacobian(t, Y);
+      }
+      if (gammaH != factoredGammaH && !factorize(gammaH)) {
+        return false;
+      }
+      if (newton(t, psi, gammaH, Y)) {
+        return true;
+      }
+      if (jacobianFresh) {
+        return false;
+      }
+      jacobianStale = true;
+      Y = psi;
+    }
+    return false;
+  };
+
+  // halves the attempted step size h after a failed step, false once it has
+  // become too small to make progress. h, not dt, as the last step is
+  // clamped to tEnd and may be shorter
+  bool reduceStepSize(double h) {
+    this->stepRejected();
+    this->dt = h / 2;
+    if (this->dt < 1e-14 * std::max(1.0, std::abs(this->t_i))) {
+      spdlog::error(this->name + ": Newton iteration fails at t = {}",
+                    this->t_i);
+      this->tEnd = this->t_i;
+      return false;
+    }
+    return true;
+  };
+
+  // called by the steps once a step is accepted
+  void stepAccepted() {
+    jacobianFresh = false;
+    this->dt = std::min(nominalDt, 2 * this->dt);
+  };
+
+private:
+  bool newton(double t, const StateType &psi, double gammaH, StateType &Y) {
+    int dim = Y.getDim();
+    // no rate yet in the first iteration, its update has to be small itself
+    double eta = 1;
+    double previousNorm = 0;
+    for (int k = 0; k < maxNewtonIterations; k++) {
+      this->evalRhs(t, Y, f);
+      residual = psi + gammaH * f - Y;
+      lu.solve(&residual[0]);
+      Y += residual;
+
+      double sum = 0;
+      for (int j = 0; j < dim; j++) {
+        double e =
+            residual[j] / (newtonAtol + newtonRtol * std::abs(Y[j]));
+        sum += e * e;
+      }
+      double norm = std::sqrt(sum / std::max(dim, 1));
+      if (!std::isfinite(norm)) {
+        return false;
+      }
+      if (k > 0) {
+        double theta = norm / previousNorm;
+        // diverging or too slow, the estimate below would be meaningless
+        if (theta > maxNewtonRate) {
+          return false;
+        }
+        eta = theta / (1 - theta);
+        // slow convergence, refresh the Jacobian before the next stage
+        if (k >= 3 || theta > 0.5) {
+          jacobianStale = true;
+        }
+      }
+      if (eta * norm <= newtonKappa) {
+        return true;
+      }
+      previousNorm = norm;
+    }
+    return false;
+  };
+
+  // analytic Jacobian if the problem has one, finite differences otherwise.
+  // Columns further apart than the bandwidth touch disjoint rows, so they
+  // are perturbed together: kl + ku + 1 evaluations for a banded Jacobian
+  void updateJacobian(double t, const StateType &r) {
+    J.setZero();
+    this->nJacobians++;
+    jacobianStale = false;
+    jacobianFresh = true;
+    factoredGammaH = std::numeric_limits<double>::quiet_NaN();
+    if (this->problemDefintion.jacobian(t, r, J)) {
+      return;
+    }
+    int n = r.getDim();
+    int groups = std::min(n, J.lower() + J.upper() + 1);
+    this->evalRhs(t, r, f);
+    rPerturbed = r;
+    const double eps = std::sqrt(std::numeric_limits<double>::epsilon());
+    for (int g = 0; g < groups; g++) {
+      for (int j = g; j < n; j += groups) {
+        rPerturbed[j] = r[j] + eps * std::max(1.0, std::abs(r[j]));
+      }
+      this->evalRhs(t, rPerturbed, fPerturbed);
+      for (int j = g; j < n; j += groups) {
+        double h = rPerturbed[j] - r[j];
+        int iEnd = std::min(n - 1, j + J.lower());
+        for (int i = std::max(0, j - J.upper()); i <= iEnd; i++) {
+          J(i, j) = (fPerturbed[i] - f[i]) / h;
+        }
+        rPerturbed[j] = r[j];
+      }
+    }
+  };
+
+  bool factorize(double gammaH) {
+    lu = J;
+    lu.scaleAndAddIdentity(-gammaH);
+    this->nFactorizations++;
+    factoredGammaH = gammaH;
+    if (!lu.factorize()) {
+      factoredGammaH = std::numeric_limits<double>::quiet_NaN();
+      return false;
+    }
+    return true;
+  };
+
+  Matrix J, lu;
+  double nominalDt = 1;
+  double factoredGammaH = std::numeric_limits<double>::quiet_NaN();
+  bool jacobianStale = true;
+  // computed during the current step, recomputing it would not help
+  bool jacobianFresh = false;
+  double newtonRtol = 1e-10;
+  // small components matter: a stage error in a stiff component is
+  // amplified by gammaH J in the step
+  double newtonAtol = 1e-14;
+  static constexpr double newtonKappa = 0.1;
+  static constexpr double maxNewtonRate = 0.9;
+  long nJacobians = 0;
+  long nFactorizations = 0;
+  static constexpr int maxNewtonIterations = 7;
+
+  StateType f, residual, rPerturbed, fPerturbed;
+};
+
+// y_n+1 = y_n + h f(t_n+1, y_n+1), L-stable, first order
+template <typename ProblemType, typename DataType>
+class BackwardEuler : public ImplicitSolver<ProblemType, DataType> {
+public:
+  using StateType = typename Solver<ProblemType, DataType>::StateType;
+
+  BackwardEuler(){};
+  BackwardEuler(const ProblemType &problem, double dt_,
+                int maxIteration_ = 10000)
+      : ImplicitSolver<ProblemType, DataType>(problem, dt_, maxIteration_) {
+    this->name = "Backward Euler";
+    y.resize(this->r_i.getDim());
+  };
+
+  void step() override {
+    while (true) {
+      double h = this->nextStepSize();
+      y = this->r_i;
+      if (this->solveStage(this->t_i + h, this->r_i, h, y)) {
+        std::swap(this->r_i, y);
+        this->t_i += h;
+        this->stepAccepted();
+        this->update();
+        return;
+      }
+      if (!this->reduceStepSize(h)) {
+        return;
+      }
+    }
+  };
+
+private:
+  StateType y;
+};
+
+// Two step backward differentiation formula with variable step size, the
+// first step is a backward Euler step. A-stable, second order
+template <typename ProblemType, typename DataType>
+class BDF2 : public ImplicitSolver<ProblemType, DataType> {
+public:
+  using StateType = typename Solver<ProblemType, DataType>::StateType;
+
+  BDF2(){};
+  BDF2(const ProblemType &problem, double dt_, int maxIteration_ = 10000)
+      : ImplicitSolver<ProblemType, DataType>(problem, dt_, maxIteration_) {
+    this->name = "BDF2";
+    int dim = this->r_i.getDim();
+    for (StateType *v : {&y, &psi, &rOld}) {
+      v->resize(dim);
+    }
+  };
+
+  void step() override {
+    while (true) {
+      double h = this->nextStepSize();
+      double gammaH = h;
+      if (hPrevious > 0) {
+        // y_n+1 = a y_n - b y_n-1 + c h f_n+1 with w = h / h_n-1
+        double w = h / hPrevious;
+        double a = (1 + w) * (1 + w) / (1 + 2 * w);
+        double b = w * w / (1 + 2 * w);
+        gammaH = (1 + w) / (1 + 2 * w) * h;
+        psi = a * this->r_i - b * rOld;
+        y = (1 + w) * this->r_i - w * rOld;
+      } else {
+        psi = this->r_i;
+        y = this->r_i;
+      }
+      if (this->solveStage(this->t_i + h, psi, gammaH, y)) {
+        std::swap(rOld, this->r_i);
+        std::swap(this->r_i, y);
+        hPrevious = h;
+        this->t_i += h;
+        this->stepAccepted();
+        this->update();
+        return;
+      }
+      if (!this->reduceStepSize(h)) {
+        return;
+      }
+    }
+  };
+
+protected:
+  // the two step formula needs a step from the current state first
+  void restart() override { hPrevious = 0; };
+
+private:
+  double hPrevious = 0;
+  // y_n-1 of the formula. Solver::rPrevious is the dense output's start of
+  // the step and only kept up to date with output times or events
+  StateType y, psi, rOld;
+};
+
+// Two stage singly diagonally implicit Runge-Kutta method of Alexander,
+// gamma = 1 - 1/sqrt(2). Stiffly accurate and L-stable, second order. Both
+// stages share gamma h and with it the factorization
+template <typename ProblemType, typename DataType>
+class SDIRK2 : public ImplicitSolver<ProblemType, DataType> {
+public:
+  using StateType = typename Solver<ProblemType, DataType>::StateType;
+
+  SDIRK2(){};
+  SDIRK2(const ProblemType &problem, double dt_, int maxIteration_ = 10000)
+      : ImplicitSolver<ProblemType, DataType>(problem, dt_, maxIteration_) {
+    this->name = "SDIRK2";
+    int dim = this->r_i.getDim();
+    for (StateType *v : {&y1, &y2, &psi}) {
+      v->resize(dim);
+    }
+  };
+
+  void step() override {
+    while (true) {
+      double h = this->nextStepSize();
+      double t = this->t_i;
+      const StateType &r = this->r_i;
+      y1 = r;
+      if (this->solveStage(t + gamma * h, r, gamma * h, y1)) {
+        // h f(Y1) = (Y1 - y_n) / gamma, so the second stage needs no
+        // further evaluation of f at Y1
+        psi = r + ((1 - gamma) / gamma) * (y1 - r);
+        y2 = y1;
+        if (this->solveStage(t + h, psi, gamma * h, y2)) {
+          std::swap(this->r_i, y2);
+          this->t_i += h;
+          this->stepAccepted();
+          this->update();
+          return;
+        }
+      }
+      if (!this->reduceStepSize(h)) {
+        return;
+      }
+    }
+  };
+
+private:
+  static constexpr double gamma = 1 - 0.70710678118654752440;
+  StateType y1, y2, psi;
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <vector>
+
+// Square matrix of size n with lower bandwidth kl and upper bandwidth ku,
+// only entries with -kl <= j - i <= ku are stored and may be written. A
+// negative bandwidth means the full width, so Matrix(n) is dense. Every row
+// keeps kl extra slots right of the band for the fill in of the pivoted LU
+// factorization, memory is n * min(n, 2 kl + ku + 1) doubles.
+class Matrix {
+public:
+  Matrix(int n_ = 0, int lower_ = -1, int upper_ = -1) {
+    resize(n_, lower_, upper_);
+  };
+
+  void resize(int n_, int lower_ = -1, int upper_ = -1);
+  int size() const { return this->n; };
+  int lower() const { return this->kl; };
+  int upper() const { return this->ku; };
+  bool isBanded() const {
+    return this->kl < this->n - 1 || this->ku < this->n - 1;
+  };
+
+  double &operator()(int i, int j) { return this->values[index(i, j)]; };
+  double operator()(int i, int j) const { return this->values[index(i, j)]; };
+
+  // sets all entries, including the fill in slots, to zero
+  void setZero();
+  // A = I + scale * A on the band
+  void scaleAndAddIdentity(double scale);
+
+  // LU factorization with partial pivoting in place, O(n kl (kl + ku)).
+  // Returns false if the matrix is singular
+  bool factorize();
+  // solves A x = b with the factorization, b is overwritten by x
+  void solve(double *b) const;
+
+private:
+  // first column stored for row i, shifted left at the bottom rows so every
+  // row has width slots inside the matrix
+  int rowStart(int i) const {
+    int start = i - this->kl > 0 ? i - this->kl : 0;
+    return start < this->n - this->width ? start : this->n - this->width;
+  };
+  int index(int i, int j) const {
+    return i * this->width + j - rowStart(i);
+  };
+
+  int n = 0, kl = 0, ku = 0, width = 0;
+  std::vector<double> values;
+  std::vector<int> pivots;
+};
@@ -0,0 +1,251 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <spdlog/spdlog.h>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Receives the states of a solver: the current one when it is attached and
+// then the state after every step. Observers decide what to keep, so the
+// memory of a run does not have to grow with the number of steps.
+template <typename StateType> class Observer {
+public:
+  virtual ~Observer() = default;
+  // r is only valid during the call, observers copy what they need
+  virtual void observe(int step, double t, const StateType &r) = 0;
+  // called when integrate() returns
+  virtual void flush(){};
+};
+
+// every observed state, the solver's default history
+template <typename StateType> class History : public Observer<StateType> {
+public:
+  void observe(int step, double t, const StateType &r) override {
+    this->t.push_back(t);
+    this->r.push_back(r);
+  };
+  void clear() {
+    this->t.clear();
+    this->r.clear();
+  };
+  const std::vector<double> &getT() const { return this->t; };
+  const std::vector<StateType> &getR() const { return this->r; };
+
+private:
+  std::vector<double> t;
+  std::vector<StateType> r;
+};
+
+// only the latest state, assignment reuses the buffer after the first call
+template <typename StateType> class KeepLast : public Observer<StateType> {
+public:
+  void observe(int step, double t, const StateType &r) override {
+    this->step = step;
+    this->t = t;
+    this->r = r;
+  };
+  int getStep() const { return this->step; };
+  double getT() const { return this->t; };
+  const StateType &getR() const { return this->r; };
+
+private:
+  int step = -1;
+  double t = 0;
+  StateType r;
+};
+
+// forwards every k-th step to another observer
+template <typename StateType> class Decimate : public Observer<StateType> {
+public:
+  Decimate(Observer<StateType> &target_, int every_)
+      : target(target_), every(std::max(every_, 1)){};
+  void observe(int step, double t, const StateType &r) override {
+    if (step % this->every == 0) {
+      this->target.observe(step, t, r);
+    }
+  };
+  void flush() override { this->target.flush(); };
+
+private:
+  Observer<StateType> &target;
+  int every;
+};
+
+// the last capacity states, all slots are allocated up front and reused
+template <typename StateType> class RingBuffer : public Observer<StateType> {
+public:
+  RingBuffer(int capacity_) : t(std::max(capacity_, 1)), r(t.size()){};
+  void observe(int step, double t, const StateType &r) override {
+    int slot = (this->first + this->count) % capacity();
+    if (this->count < capacity()) {
+      this->count++;
+    } else {
+      this->first = (this->first + 1) % capacity();
+    }
+    this->t[slot] = t;
+    this->r[slot] = r;
+  };
+  int capacity() const { return this->t.size(); };
+  int size() const { return this->count; };
+  // k-th stored state, 0 is the oldest
+  double getT(int k) const { return this->t[(this->first + k) % capacity()]; };
+  const StateType &getR(int k) const {
+    return this->r[(this->first + k) % capacity()];
+  };
+
+private:
+  std::vector<double> t;
+  std::vector<StateType> r;
+  int first = 0;
+  int count = 0;
+};
+
+// Appends one fixed size record per state to a binary file: t as a double
+// followed by the raw bytes of the dim elements of r. Records are collected
+// in a buffer of bufferSize bytes; a full buffer is written synchronously or,
+// with async, handed to a writer thread while the solver fills a second one.
+// A failed write, e.g. on a full disk, is logged once and leaves good() false,
+// the file is then incomplete.
+template <typename StateType>
+class BinaryFileWriter : public Observer<StateType> {
+public:
+  BinaryFileWriter(const std::string &path, bool async_ = false,
+                   std::size_t bufferSize = 1 << 20)
+      : file(path, std::ios::binary | std::ios::trunc), path(path),
+        async(async_) {
+    if (!this->file) {
+      throw std::runtime_error("cannot open " + path + " for writing");
+    }
+    this->buffer.resize(std::max<std::size_t>(bufferSize, 64));
+    if (this->async) {
+      this->pending.resize(this->buffer.size());
+      this->writer = std::thread([this] { writerLoop(); });
+    }
+  };
+  BinaryFileWriter(const BinaryFileWriter &) = delete;
+  BinaryFileWriter &operator=(const BinaryFileWriter &) = delete;
+
+  ~BinaryFileWriter() {
+    flush();
+    if (this->async) {
+      {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stop = true;
+      }
+      this->cv.notify_all();
+      this->writer.join();
+    }
+  };
+
+  void observe(int step, double t, const StateType &r) override {
+    using ValueType = std::remove_cv_t<std::remove_reference_t<decltype(r[0])>>;
+    static_assert(std::is_trivially_copyable_v<ValueType>,
+                  "BinaryFileWriter needs trivially copyable elements");
+    append(&t, sizeof(double));
+    if (r.getDim() > 0) {
+      append(&r[0], r.getDim() * sizeof(ValueType));
+    }
+  };
+
+  // writes everything observed so far to the file
+  void flush() override {
+    submit();
+    if (this->async) {
+      std::unique_lock<std::mutex> lock(this->mutex);
+      this->cv.wait(lock, [this] { return this->pendingBytes == 0; });
+    }
+    this->file.flush();
+    checkStream();
+  };
+
+  // false once a write to the file has failed
+  bool good() const { return !this->failed; };
+
+protected:
+  void append(const void *data, std::size_t bytes) {
+    const char *src = static_cast<const char *>(data);
+    while (bytes > 0) {
+      std::size_t n = std::min(bytes, this->buffer.size() - this->filled);
+      std::memcpy(this->buffer.data() + this->filled, src, n);
+      this->filled += n;
+      src += n;
+      bytes -= n;
+      if (this->filled == this->buffer.size()) {
+        submit();
+      }
+    }
+  };
+
+  // writes the filled part of the buffer, or swaps it with the writer thread's
+  // buffer once that one has been written
+  void submit() {
+    if (this->filled == 0) {
+      return;
+    }
+    if (!this->async) {
+      this->file.write(this->buffer.data(), this->filled);
+      checkStream();
+      this->filled = 0;
+      return;
+    }
+    {
+      std::unique_lock<std::mutex> lock(this->mutex);
+      this->cv.wait(lock, [this] { return this->pendingBytes == 0; });
+      std::swap(this->buffer, this->pending);
+      this->pendingBytes = this->filled;
+    }
+    this->filled = 0;
+    this->cv.notify_all();
+  };
+
+  // reports the first failure of the stream, called by the thread writing
+  void checkStream() {
+    if (this->file.fail() && !this->failed.exchange(true)) {
+      spdlog::error("writing {} failed, the file is incomplete", this->path);
+    }
+  };
+
+  std::ofstream file;
+  std::string path;
+
+private:
+  void writerLoop() {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    while (true) {
+      this->cv.wait(lock,
+                    [this] { return this->pendingBytes > 0 || this->stop; });
+      if (this->pendingBytes == 0) {
+        return;
+      }
+      // pending is not touched by the solver thread until pendingBytes is 0
+      lock.unlock();
+      this->file.write(this->pending.data(), this->pendingBytes);
+      checkStream();
+      lock.lock();
+      this->pendingBytes = 0;
+      this->cv.notify_all();
+    }
+  };
+
+  bool async;
+  std::atomic<bool> failed{false};
+  std::vector<char> buffer;
+  std::size_t filled = 0;
+
+  // state shared with the writer thread, guarded by mutex
+  std::vector<char> pending;
+  std::size_t pendingBytes = 0;
+  bool stop = false;
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::thread writer;
+};
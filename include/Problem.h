@@ -3,122 +3,57 @@
 #include <cassert>
 #include <iostream>
 #include <math.h>
+#include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 #include <spdlog/spdlog.h>
 
-template <typename T> class Vector {
-public:
-  Vector(int dim_) {
-    this->dim = dim;
-    this->data = std::vector<T>(this->dim);
-    setXYZ();
-  }
-  Vector(std::vector<T> &data_) : data(data_), dim(data.size()) {setXYZ();}
-  Vector(){
-    this->dim = 0;
-    this->data = std::vector<T>(0); 
-  };
-  Vector(const Vector &other) {
-    if(other.dim > 0){
-      this->data = std::vector<T>(other.dim);
-      this->data = other.data;
-      this->dim = other.dim;
-      setXYZ();
-    }
-  }
-
-  void setXYZ(){
-    if(dim > 3){
-      this->x = data[0];
-      this->y = data[1];
-      this->z = data[2];
-    }
-    else if(dim == 2){
-      this->x = data[0];
-      this->y = data[1];
-    }
-    else if(dim == 1){
-      this->x = data[0];
-    }
-  }
+#include "Matrix.h"
+#include "Particles.h"
+#include "Vector.h"
 
-  Vector operator+(const Vector &other) const {
-    assert(this->dim == other.dim);
-    Vector res(this->dim);
-    for (int i = 0; i < this->dim; i++) {
-      res.data[i] = this->data[i] + other.data[i];
-    }
-    return res;
+struct Body {
+  Body(double m, double rx_, double ry_, double vx_, double vy_)
+      : mass(m), position{rx_, ry_}, velocity{vx_, vy_} {
+    // objectID = objectCount++;
   };
+  Body(double rx_, double ry_, double vx_, double vy_)
+      : Body(1, rx_, ry_, vx_, vy_){};
+  Body() : Body(0, 0, 0, 0, 0){};
 
-  Vector operator-(const Vector &other) const { return this + (-1) * other; }
+  double dist(const Body &other) const {
+    double dx = position[0] - other.position[0];
+    double dy = position[1] - other.position[1];
+    return sqrt(dx * dx + dy * dy);
+  }
 
-  Vector operator*(const double &scalar) const {
-    Vector res(this->dim);
-    for (int i = 0; i < this->dim; i++) {
-      res.data[i] = this->data[i] * scalar;
-    }
+  // bodies form a vector space so the solvers can integrate Vector<Body>: a
+  // derivative is a Body holding the velocity in position, the acceleration
+  // in velocity and a zero mass, which keeps the mass constant in r + h * k
+  Body operator+(const Body &other) const {
+    Body res(mass + other.mass, 0, 0, 0, 0);
+    res.position = position + other.position;
+    res.velocity = velocity + other.velocity;
+    res.objectID = objectID;
     return res;
-  };
-  friend Vector operator*(const double &scalar, const Vector &vec) {
-    return vec * scalar;
   }
-
-  Vector operator/(const double &scalar) const {
-    Vector res(this->dim);
-    for (int i = 0; i < this->dim; i++) {
-      res.data[i] = this->data[i] / scalar;
-    }
+  Body operator-(const Body &other) const {
+    Body res(mass - other.mass, 0, 0, 0, 0);
+    res.position = position - other.position;
+    res.velocity = velocity - other.velocity;
+    res.objectID = objectID;
     return res;
-  };
-
-  friend Vector operator/(const double &scalar, const Vector &vec) {
-    return vec / scalar;
   }
-
-  T operator[](int index) { return this->data[index]; }
-  T getX() { return this->x; };
-  T getY() { return this->y; };
-  T getZ() { return this->z; };
-
-  int getDim() { return this->dim; }
-
-  std::string toStr() {
-    std::string res = "[ ";
-    for (int i = 0; i < data.size() - 1; i++) {
-      res += std::to_string(data[i]) + ", ";
-    }
-    res += std::to_string(data[data.size() - 1]) + " ]";
+  Body operator*(const double &scalar) const {
+    Body res(mass * scalar, 0, 0, 0, 0);
+    res.position = position * scalar;
+    res.velocity = velocity * scalar;
+    res.objectID = objectID;
     return res;
-  };
-
-private:
-  std::vector<T> data;
-  T x;
-  T y;
-  T z;
-  int dim = 1;
-};
-
-struct Body {
-  Body(double m, double rx_, double ry_, double vx_, double vy_) : mass(m) {
-    std::vector<double> pos = {rx_, ry_};
-    std::vector<double> vel = {vx_, vy_};
-    position = Vector<double>(pos);
-    velocity = Vector<double>(vel);
-    // objectID = objectCount++;
-  };
-  Body(double rx_, double ry_, double vx_, double vy_)
-      : Body(1, rx_, ry_, vx_, vy_){};
-  Body() : Body(0, 0, 0, 0, 0){};
-
-  double dist(Body &other) {
-    return sqrt(pow(position[0] - other.position[0], 2) +
-                pow(position[1] - other.position[1], 2));
   }
 
-  std::string toStr() {
+  std::string toStr() const {
     std::string res = "Body id : " + std::to_string(objectID) + "\n\t r: [ ";
     for (int i = 0; i < position.getDim() - 1; i++) {
       res += std::to_string(position[i]) + ", ";
@@ -133,25 +68,97 @@ struct Body {
   };
 
   double mass;
-  Vector<double> position;
-  Vector<double> velocity;
+  Vector<double, 2> position;
+  Vector<double, 2> velocity;
   // static int objectCount;
-  int objectID;
+  int objectID = 0;
 };
 
 // int Body::objectCount = 0;
 
 // class containing a initial value problem, defintion of evaluatin f and
-// initial values used for it
-template <typename T> class ODE_Problem {
+// initial values used for it. N fixes the state dimension at compile time,
+// the default Dynamic sizes it at runtime
+template <typename T, int N = Dynamic> class ODE_Problem {
 public:
+  using ValueType = T;
+  using StateType = Vector<T, N>;
+
   ODE_Problem(){
     spdlog::info("Calling Default ODE_Problem Constructor");
   };
-  virtual Vector<T> eval(double t_i, const Vector<T> &r_i) {
-    return Vector<T>(0);
+  virtual StateType eval(double t_i, const StateType &r_i) {
+    return StateType();
+  };
+  // in-place variant used by the solvers, writes f(t_i, r_i) into out. The
+  // default forwards to the allocating eval, problems on the hot path should
+  // override it and write straight into out
+  virtual void eval(double t_i, const StateType &r_i, StateType &out) {
+    out = eval(t_i, r_i);
+  };
+  // evaluates f for nTrajectories states of dimension dim_ at once. The states
+  // are stored component major, component c of trajectory j is
+  // r_i[c * nTrajectories + j], so problems overriding this can vectorise
+  // across trajectories. The default gathers every trajectory and calls eval
+  virtual void evalEnsemble(double t_i, int dim_, int nTrajectories,
+                            const T *r_i, T *out) {
+    StateType r_j(dim_), f_j(dim_);
+    for (int j = 0; j < nTrajectories; j++) {
+      for (int c = 0; c < dim_; c++) {
+        r_j[c] = r_i[c * nTrajectories + j];
+      }
+      eval(t_i, r_j, f_j);
+      for (int c = 0; c < dim_; c++) {
+        out[c * nTrajectories + j] = f_j[c];
+      }
+    }
+  };
+  // Hooks of the symplectic solvers for second order systems x'' = a(t, x)
+  // with a state split into positions and velocities. The defaults assume the
+  // first half of the state holds the positions, the second half the
+  // velocities and eval returns (velocities, accelerations).
+  // writes the accelerations at r_i into a, only kick reads them
+  virtual void evalAcceleration(double t_i, const StateType &r_i,
+                                StateType &a) {
+    eval(t_i, r_i, a);
+  };
+  // positions += h * velocities
+  virtual void drift(StateType &r_i, double h) {
+    int half = r_i.getDim() / 2;
+    for (int j = 0; j < half; j++) {
+      r_i[j] = r_i[j] + r_i[half + j] * h;
+    }
+  };
+  // velocities += h * accelerations
+  virtual void kick(StateType &r_i, const StateType &a, double h) {
+    int half = r_i.getDim() / 2;
+    for (int j = half; j < 2 * half; j++) {
+      r_i[j] = r_i[j] + a[j] * h;
+    }
+  };
+  // f(t_i, r_i) from the accelerations a at r_i, the velocities are taken
+  // from r_i. The dense output of the symplectic solvers gets its derivatives
+  // from the last kick this way, out may be a
+  virtual void rhsFromAcceleration(const StateType &r_i, const StateType &a,
+                                   StateType &out) {
+    int half = r_i.getDim() / 2;
+    for (int j = 0; j < half; j++) {
+      out[half + j] = a[half + j];
+      out[j] = r_i[half + j];
+    }
+  };
+  // Jacobian df/dr at (t_i, r_i) for the implicit solvers. J is sized with
+  // the bandwidths below and zeroed, only entries inside the band may be
+  // written. Problems without an analytic Jacobian return false and the
+  // solvers fall back to finite differences
+  virtual bool jacobian(double t_i, const StateType &r_i, Matrix &J) {
+    return false;
   };
-  void init(double t_0_, Vector<T>& r_0_) {
+  // lower and upper bandwidth of df/dr, negative for a dense Jacobian. A
+  // banded Jacobian is stored, factorized and differenced in O(dim) work
+  virtual int jacobianLowerBandwidth() const { return -1; };
+  virtual int jacobianUpperBandwidth() const { return -1; };
+  void init(double t_0_, StateType& r_0_) {
     this->t_0 = t_0_;
     this->r_0 = r_0_;
   };
@@ -159,15 +166,108 @@ public:
 
   int dim = 1;
   int nParticles = 1;
-  Vector<T> r_0;
+  StateType r_0;
   double t_0;
 };
 
-class Linear_ODE : public ODE_Problem<double> {
+// Problem from a callable f(t, r, out) writing the derivative into out, e.g.
+// a lambda. The solvers hold their problem by its concrete type, so they call
+// eval, and with it f, directly and inline it into their stages:
+//   FunctionProblem lorenz(
+//       [](double t, const Vector<double, 3> &r, Vector<double, 3> &out) {
+//         ...
+//       },
+//       Vector<double, 3>{1, 1, 1});
+//   RungeKutta4<decltype(lorenz), double> solver(lorenz, 1e-3);
+template <typename F, typename T = double, int N = Dynamic>
+class FunctionProblem final : public ODE_Problem<T, N> {
+public:
+  using StateType = Vector<T, N>;
+
+  FunctionProblem(F f_, const Vector<T, N> &r_0_, double t_0_ = 0)
+      : f(std::move(f_)) {
+    this->r_0 = r_0_;
+    this->t_0 = t_0_;
+    this->dim = r_0_.getDim();
+  };
+
+  StateType eval(double t_i, const StateType &r_i) override {
+    StateType r_j(r_i.getDim());
+    eval(t_i, r_i, r_j);
+    return r_j;
+  };
+
+  void eval(double t_i, const StateType &r_i, StateType &out) override {
+    f(t_i, r_i, out);
+  };
+
+private:
+  F f;
+};
+
+// Forwards every hook to a problem held by shared_ptr, through its virtual
+// functions. Solvers instantiated on it pick the problem at run time without
+// slicing it, the price is an indirect call per evaluation that cannot be
+// inlined. Copies of the solver share the problem
+template <typename T, int N = Dynamic>
+class VirtualProblem final : public ODE_Problem<T, N> {
+public:
+  using StateType = Vector<T, N>;
+
+  VirtualProblem(){};
+  VirtualProblem(std::shared_ptr<ODE_Problem<T, N>> problem_)
+      : problem(std::move(problem_)) {
+    this->r_0 = problem->r_0;
+    this->t_0 = problem->t_0;
+    this->dim = problem->dim;
+    this->nParticles = problem->nParticles;
+  };
+
+  StateType eval(double t_i, const StateType &r_i) override {
+    return problem->eval(t_i, r_i);
+  };
+  void eval(double t_i, const StateType &r_i, StateType &out) override {
+    problem->eval(t_i, r_i, out);
+  };
+  void evalEnsemble(double t_i, int dim_, int nTrajectories, const T *r_i,
+                    T *out) override {
+    problem->evalEnsemble(t_i, dim_, nTrajectories, r_i, out);
+  };
+  void evalAcceleration(double t_i, const StateType &r_i,
+                        StateType &a) override {
+    problem->evalAcceleration(t_i, r_i, a);
+  };
+  void drift(StateType &r_i, double h) override { problem->drift(r_i, h); };
+  void kick(StateType &r_i, const StateType &a, double h) override {
+    problem->kick(r_i, a, h);
+  };
+  void rhsFromAcceleration(const StateType &r_i, const StateType &a,
+                           StateType &out) override {
+    problem->rhsFromAcceleration(r_i, a, out);
+  };
+  bool jacobian(double t_i, const StateType &r_i, Matrix &J) override {
+    return problem->jacobian(t_i, r_i, J);
+  };
+  int jacobianLowerBandwidth() const override {
+    return problem->jacobianLowerBandwidth();
+  };
+  int jacobianUpperBandwidth() const override {
+    return problem->jacobianUpperBandwidth();
+  };
+
+private:
+  std::shared_ptr<ODE_Problem<T, N>> problem;
+};
+
+// f(t, r) = lambda r with the state dimension N fixed at compile time, see
+// Linear_ODE below for the runtime sized problem
+template <int N> class Linear_ODE_N : public ODE_Problem<double, N> {
 public:
-  Linear_ODE(){};
-  Linear_ODE(Vector<double>& r_0_, double t_0_,
-             double lambda_) {
+  using StateType = Vector<double, N>;
+
+  Linear_ODE_N(){};
+  Linear_ODE_N(StateType& r_0_, double t_0_,
+               double lambda_) {
     spdlog::info("starting construction");
     this->r_0 = r_0_;
     this->t_0 = t_0_;
@@ -175,27 +275,158 @@ public:
     this->dim = 1;
   };
 
-  Vector<double> eval(double t_i, const Vector<double> &r_i) override {
-    Vector<double> r_j = r_i * lambda;
-    return lambda * r_i;
-    // return r_j;
+  StateType eval(double t_i, const StateType &r_i) override {
+    StateType r_j(r_i.getDim());
+    eval(t_i, r_i, r_j);
+    return r_j;
+  };
+
+  void eval(double t_i, const StateType &r_i, StateType &out) override {
+    out = lambda * r_i;
+  };
+
+  // f acts on every component separately, the Jacobian is lambda I
+  bool jacobian(double t_i, const StateType &r_i, Matrix &J) override {
+    for (int j = 0; j < r_i.getDim(); j++) {
+      J(j, j) = lambda;
+    }
+    return true;
+  };
+  int jacobianLowerBandwidth() const override { return 0; };
+  int jacobianUpperBandwidth() const override { return 0; };
+
+  void evalEnsemble(double t_i, int dim_, int nTrajectories,
+                    const double *r_i, double *out) override {
+    // local copy, the stores through out could otherwise alias lambda
+    double l = lambda;
+    for (int j = 0; j < dim_ * nTrajectories; j++) {
+      out[j] = l * r_i[j];
+    }
   };
 
   double lambda;
 };
 
-class LorenzAttractor : public ODE_Problem<double>{
+class Linear_ODE : public Linear_ODE_N<Dynamic> {
+public:
+  using Linear_ODE_N<Dynamic>::Linear_ODE_N;
+};
+
+class LorenzAttractor : public ODE_Problem<double, 3> {
+public:
   LorenzAttractor(){
     ;
   };
-  Vector<double> eval(double t_i, const Vector<double> &r_i) override {
-    return Vector<double>(0);
+  LorenzAttractor(StateType &r_0_, double t_0_, double sigma_ = 10,
+                  double rho_ = 28, double beta_ = 8.0 / 3)
+      : sigma(sigma_), rho(rho_), beta(beta_) {
+    this->r_0 = r_0_;
+    this->t_0 = t_0_;
+    this->dim = 3;
+  };
+
+  StateType eval(double t_i, const StateType &r_i) override {
+    StateType r_j;
+    eval(t_i, r_i, r_j);
+    return r_j;
+  };
+
+  void eval(double t_i, const StateType &r_i, StateType &out) override {
+    out[0] = sigma * (r_i[1] - r_i[0]);
+    out[1] = r_i[0] * (rho - r_i[2]) - r_i[1];
+    out[2] = r_i[0] * r_i[1] - beta * r_i[2];
+  };
+
+  void evalEnsemble(double t_i, int dim_, int nTrajectories,
+                    const double *r_i, double *out) override {
+    evalKernel(nTrajectories, r_i, r_i + nTrajectories,
+               r_i + 2 * nTrajectories, out, out + nTrajectories,
+               out + 2 * nTrajectories, sigma, rho, beta);
+  };
+
+  double sigma = 10;
+  double rho = 28;
+  double beta = 8.0 / 3;
+
+private:
+  // out never overlaps r_i, restrict lets the compiler vectorise the loop
+  static void evalKernel(int n, const double *__restrict x,
+                         const double *__restrict y,
+                         const double *__restrict z, double *__restrict fx,
+                         double *__restrict fy, double *__restrict fz,
+                         double s, double r, double b) {
+    for (int j = 0; j < n; j++) {
+      fx[j] = s * (y[j] - x[j]);
+      fy[j] = x[j] * (r - z[j]) - y[j];
+      fz[j] = x[j] * y[j] - b * z[j];
+    }
+  };
+};
+
+// Fisher-KPP reaction diffusion u_t = D u_xx + k u (1 - u) on [0, 1] with
+// u = 0 at both ends, discretised by central differences on nPoints interior
+// points. The diffusion makes the system stiff, its fastest mode decays with
+// about 4 D / dx^2, the Jacobian is tridiagonal
+class ReactionDiffusion : public ODE_Problem<double> {
+public:
+  ReactionDiffusion(int nPoints, double diffusion_ = 1, double rate_ = 10)
+      : diffusion(diffusion_), rate(rate_) {
+    double dx = 1.0 / (nPoints + 1);
+    this->r_0 = StateType(nPoints);
+    for (int j = 0; j < nPoints; j++) {
+      double x = (j + 1) * dx;
+      this->r_0[j] = std::exp(-100 * (x - 0.5) * (x - 0.5));
+    }
+    this->t_0 = 0;
+    this->dim = nPoints;
+  };
+
+  StateType eval(double t_i, const StateType &r_i) override {
+    StateType r_j(r_i.getDim());
+    eval(t_i, r_i, r_j);
+    return r_j;
+  };
+
+  void eval(double t_i, const StateType &r_i, StateType &out) override {
+    int n = r_i.getDim();
+    double c = diffusion * (n + 1) * (n + 1);
+    for (int j = 0; j < n; j++) {
+      double left = j > 0 ? r_i[j - 1] : 0;
+      double right = j < n - 1 ? r_i[j + 1] : 0;
+      out[j] = c * (left - 2 * r_i[j] + right) + rate * r_i[j] * (1 - r_i[j]);
+    }
+  };
+
+  bool jacobian(double t_i, const StateType &r_i, Matrix &J) override {
+    int n = r_i.getDim();
+    double c = diffusion * (n + 1) * (n + 1);
+    for (int j = 0; j < n; j++) {
+      if (j > 0) {
+        J(j, j - 1) = c;
+      }
+      J(j, j) = -2 * c + rate * (1 - 2 * r_i[j]);
+      if (j < n - 1) {
+        J(j, j + 1) = c;
+      }
+    }
+    return true;
   };
+  int jacobianLowerBandwidth() const override { return 1; };
+  int jacobianUpperBandwidth() const override { return 1; };
+
+  double diffusion;
+  double rate;
 };
 
 class N_Body : public ODE_Problem<Body> {
 public:
-  N_Body(int nBodies, double gravity_) {
+  // DIRECT sums all pairs in O(N^2) and serves as the reference,
+  // BARNES_HUT approximates distant groups of bodies by their centre of mass
+  // in a quadtree, O(N log N), DIRECT_SIMD sums all pairs with the tiled SIMD
+  // kernel on a structure of arrays copy of the bodies
+  enum ForceMethod { DIRECT, BARNES_HUT, DIRECT_SIMD };
+
+  N_Body(int nBodies, double gravity_) : gravity(gravity_) {
     this->nParticles = nBodies;
     this->dim = 2;
   };
@@ -211,10 +442,63 @@ public:
     this->nParticles = 0;
     this->dim = 2;
   };
-  // yn is given in the format, that the first n elements correspond to the
-  // position of the ith body, and the second n elements correspond to the
-  // velocity of the ith body
+
+  N_Body(Vector<Body> &bodies, double t_0_, double gravity_ = 1)
+      : gravity(gravity_) {
+    this->r_0 = bodies;
+    this->t_0 = t_0_;
+    this->nParticles = bodies.getDim();
+    this->dim = 2;
+  };
+
+  // every element of r_i is a body, the derivative of body i is stored as a
+  // Body with its velocity as position and its acceleration as velocity
+  using ODE_Problem<Body>::eval;
   Vector<Body> eval(double t_0, const Vector<Body> &r_i) override;
+  void eval(double t_i, const Vector<Body> &r_i, Vector<Body> &out) override;
+
+  // split hooks of the symplectic solvers, the acceleration of body i is
+  // written into a[i].velocity
+  void evalAcceleration(double t_i, const Vector<Body> &r_i,
+                        Vector<Body> &a) override;
+  void drift(Vector<Body> &r_i, double h) override;
+  void kick(Vector<Body> &r_i, const Vector<Body> &a, double h) override;
+  void rhsFromAcceleration(const Vector<Body> &r_i, const Vector<Body> &a,
+                           Vector<Body> &out) override;
+
+  // total kinetic plus potential energy of the bodies
+  double energy(const Vector<Body> &r_i) const;
+
+  void setForceMethod(ForceMethod method_) { method = method_; };
+  // Barnes-Hut opening angle, a node of size s at distance d is used as a
+  // point mass if s / d < theta. Smaller is more accurate and slower
+  void setOpeningAngle(double theta_) { theta = theta_; };
+  // Plummer softening length, removes the singularity of close encounters
+  void setSoftening(double softening_) { softening = softening_; };
 
   double gravity;
+  double theta = 0.5;
+  double softening = 0;
+  ForceMethod method = DIRECT;
+
+private:
+  struct QuadNode {
+    double centerX, centerY, halfSize;
+    double mass = 0, comX = 0, comY = 0;
+    // index of the first of four consecutive children, -1 for a leaf
+    int firstChild = -1;
+    // body stored in a leaf, -1 if the leaf is empty
+    int body = -1;
+  };
+
+  void accelerationsDirect(const Vector<Body> &r_i, Vector<Body> &out) const;
+  void accelerationsBarnesHut(const Vector<Body> &r_i, Vector<Body> &out);
+  void buildTree(const Vector<Body> &r_i);
+  void insert(const Vector<Body> &r_i, int b);
+
+  // node arena, cleared but not freed between evaluations
+  std::vector<QuadNode> nodes;
+  std::vector<int> stack;
+  // structure of arrays workspace of DIRECT_SIMD
+  ParticleSystem particles;
 };
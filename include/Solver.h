@@ -1,107 +1,751 @@
 #pragma once
 
+#include "ButcherTableau.h"
+#include "Observer.h"
 #include "Problem.h"
+#include "SolverStats.h"
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <functional>
+#include <limits>
 #include <memory>
 #include <spdlog/spdlog.h>
+#include <utility>
 
 template <typename ProblemType, typename DataType> class Solver {
 public:
+  using StateType = typename ProblemType::StateType;
+
+  Solver(){};
+  Solver(const ProblemType &problem) : problemDefintion(problem){};
+  virtual ~Solver() = default;
+
   virtual void solve() {
     spdlog::info(this->name + " method is used...");
     spdlog::info("\ti\t\tt_i\t\tr_i");
     if (this->print) {
-      spdlog::info("\t{}\t\t{}\t\t" + this->r_n.front().toStr(), this->i,
-                   this->t_n.front());
-    }
-    while (this->i < this->maxI) {
-      step();
+      spdlog::info("\t{}\t\t{}\t\t" + this->r_i.toStr(), this->i, this->t_i);
     }
+    integrate();
     std::cout << std::endl;
   };
 
-  std::vector<Vector<DataType>> getYn() { return this->r_n; };
-  std::vector<double> getTn() { return this->t_n; };
+  // runs the steps of solve() without any logging
+  virtual void integrate() {
+    run([this] { step(); });
+  };
+
+  // stored states of the history, empty if it is disabled
+  const std::vector<StateType> &getYn() const { return this->history.getR(); };
+  const std::vector<double> &getTn() const { return this->history.getT(); };
+  const StateType &getR() const { return this->r_i; };
+  double getT() const { return this->t_i; };
+  int getSteps() const { return this->i; };
+  // counters and timers of the run so far, see SolverStats.h
+  const SolverStats &getStats() const { return this->stats; };
+  void resetStats() { this->stats = SolverStats(); };
+  long getRhsEvaluations() const { return this->stats.rhsEvaluations; };
+  int getRejectedSteps() const { return this->stats.rejectedSteps; };
+  // solve() stops at whichever comes first, maxI steps or the end time
+  void setEndTime(double tEnd_) { tEnd = tEnd_; };
   void setPrint(bool print_) { print = print_; };
+  // The history is stored by default and grows with every step, as getYn()
+  // and getTn() always returned all states. With it disabled only the current
+  // state is kept and a step does not touch the heap, observers then collect
+  // what is needed
+  void setStoreHistory(bool storeHistory_) {
+    storeHistory = storeHistory_;
+    if (!storeHistory) {
+      history.clear();
+    }
+  };
+  // observer is passed the current state right away and then the state after
+  // every step. The solver does not own it, it has to outlive the solver or be
+  // removed before a copy of the solver runs
+  void addObserver(Observer<StateType> &observer) {
+    observers.push_back(&observer);
+    observer.observe(this->i, this->t_i, this->r_i);
+  };
+  void removeObserver(Observer<StateType> &observer) {
+    observers.erase(std::remove(observers.begin(), observers.end(), &observer),
+                    observers.end());
+  };
   std::string getName() { return this->name; };
 
+  // Dense output: every step keeps an interpolant of the solution over its
+  // interval [t_i - h, t_i], so values in between cost no extra steps and the
+  // step size is chosen for accuracy alone. It is maintained by integrate()
+  // once enabled here or by output times or events.
+  void setDenseOutput(bool dense_) {
+    if (dense_ && !this->dense) {
+      int dim = this->r_i.getDim();
+      for (StateType *v : {&rPrevious, &fPrevious, &fCurrent, &rDense}) {
+        v->resize(dim);
+      }
+      this->fCurrentValid = false;
+    }
+    this->dense = dense_ || !this->outputTimes.empty() || !this->events.empty();
+  };
+  // value of the interpolant of the last step at t, for t within that step
+  virtual void interpolate(double t, StateType &out) {
+    // cubic Hermite through the states and derivatives at both ends
+    double h = this->t_i - this->tPrevious;
+    double s = h > 0 ? (t - this->tPrevious) / h : 1;
+    double u = 1 - s;
+    double w = s * s * (3 - 2 * s);
+    out = (1 - w) * this->rPrevious + w * this->r_i +
+          (h * s * u * u) * this->fPrevious - (h * s * s * u) * this->fCurrent;
+  };
+  // observer is passed the interpolated state at each of the increasing
+  // times, as soon as a step has passed it. Times before the current time
+  // are dropped, replaces earlier output times
+  void setOutputTimes(const std::vector<double> &times,
+                      Observer<StateType> &observer) {
+    assert(std::is_sorted(times.begin(), times.end()));
+    this->outputTimes = times;
+    this->outputObserver = &observer;
+    this->nextOutput = 0;
+    setDenseOutput(true);
+    double tol = timeTolerance(this->t_i);
+    while (this->nextOutput < this->outputTimes.size() &&
+           this->outputTimes[this->nextOutput] <= this->t_i + tol) {
+      double t = this->outputTimes[this->nextOutput++];
+      if (t >= this->t_i - tol) {
+        observer.observe(this->i, t, this->r_i);
+      }
+    }
+  };
+  // Event function g(t, r): when its sign changes within a step the root is
+  // located on the interpolant and observer is passed the state there. A
+  // terminal event ends the integration at its root
+  void addEvent(std::function<double(double, const StateType &)> g,
+                Observer<StateType> &observer, bool terminal = false) {
+    double value = g(this->t_i, this->r_i);
+    this->events.push_back({std::move(g), &observer, terminal, value});
+    setDenseOutput(true);
+  };
+
 protected:
   ProblemType problemDefintion;
   double dt = 1;
   DataType dr = DataType();
   int i = 0;
   int maxI;
+  double tEnd = std::numeric_limits<double>::infinity();
+  SolverStats stats;
+
+  // current state, the steps advance it in place
+  double t_i = 0;
+  StateType r_i;
 
-  std::vector<double> t_n = {0};
-  std::vector<Vector<DataType>> r_n = {DataType()};
+  History<StateType> history;
+  std::vector<Observer<StateType> *> observers;
 
   bool print = false;
+  bool storeHistory = true;
   std::string name;
 
+  // dense output of the last step, see setDenseOutput
+  bool dense = false;
+  double tPrevious = 0;
+  StateType rPrevious, fPrevious, fCurrent;
+  bool fPreviousValid = false;
+  bool fCurrentValid = false;
+
   virtual void step() = 0;
-  void update(double currentTime, Vector<DataType> currentPosition) {
-    this->r_n.push_back(currentPosition);
-    this->t_n.push_back(currentTime);
+  // the loop of integrate(). Solvers whose step() is final pass a stepFunction
+  // calling it directly, so it is not dispatched through the vtable every step
+  template <typename StepFunction> void run(StepFunction stepFunction) {
+    long allocations = threadAllocations;
+    auto start = statsTimerStart();
+    double evalOutput = this->stats.evalTime + this->stats.outputTime;
+    while (this->i < this->maxI && !this->reachedEnd()) {
+      if (this->dense) {
+        beginStep();
+      }
+      stepFunction();
+    }
+    auto flushStart = statsTimerStart();
+    for (Observer<StateType> *observer : this->observers) {
+      observer->flush();
+    }
+    if constexpr (solverStatsEnabled) {
+      this->stats.allocations += threadAllocations - allocations;
+    }
+    if constexpr (solverTimingEnabled) {
+      this->stats.outputTime += statsTimerElapsed(flushStart);
+      this->stats.updateTime +=
+          statsTimerElapsed(start) -
+          (this->stats.evalTime + this->stats.outputTime - evalOutput);
+    }
+  }
+
+  // Prepares the interpolant after a step, the default computes the
+  // derivative at the new state for the Hermite interpolant. It becomes the
+  // derivative at the start of the next step, see startDerivative
+  virtual void prepareInterpolant() {
+    if (!this->fPreviousValid) {
+      evalRhs(this->tPrevious, this->rPrevious, this->fPrevious);
+      this->fPreviousValid = true;
+    }
+    evalRhs(this->t_i, this->r_i, this->fCurrent);
+    this->fCurrentValid = true;
+  };
+  // f(t, r) of the problem, every evaluation by the steps goes through here
+  // or evalAcceleration for the statistics
+  void evalRhs(double t, const StateType &r, StateType &out) {
+    auto start = statsTimerStart();
+    this->problemDefintion.eval(t, r, out);
+    countEvaluation(start);
+  }
+  void evalAcceleration(double t, const StateType &r, StateType &a) {
+    auto start = statsTimerStart();
+    this->problemDefintion.evalAcceleration(t, r, a);
+    countEvaluation(start);
+  }
+  void stepRejected() {
+    if constexpr (solverStatsEnabled) {
+      this->stats.rejectedSteps++;
+    }
+  }
+  // called when the state was changed other than by a step, e.g. cut back to
+  // a terminal event. Solvers drop what they carry over between steps
+  virtual void restart(){};
+  // f(t_i, r_i) for steps that need it anyway, taken from the interpolant of
+  // the previous step if there is one, so dense output costs no evaluation
+  void startDerivative(StateType &f) {
+    if (this->dense && this->fPreviousValid) {
+      f = this->fPrevious;
+      return;
+    }
+    evalRhs(this->t_i, this->r_i, f);
+    if (this->dense) {
+      this->fPrevious = f;
+      this->fPreviousValid = true;
+    }
+  }
+  bool reachedEnd() const {
+    return std::isfinite(this->tEnd) &&
+           this->tEnd - this->t_i <=
+               1e-12 * std::max(1.0, std::abs(this->tEnd));
+  }
+  // step size of the next fixed step, shortened to land on the end time
+  double nextStepSize() const {
+    return std::min(this->dt, this->tEnd - this->t_i);
+  }
+  void init(double t_0, const StateType &r_0) {
+    this->t_i = t_0;
+    this->r_i = r_0;
+    this->history.clear();
+    if (this->storeHistory) {
+      this->history.observe(0, t_0, r_0);
+    }
+  }
+  // records the current state after a step has advanced t_i and r_i
+  void update() {
     this->i++;
+    auto start = statsTimerStart();
+    double evalTime = this->stats.evalTime;
+    if (this->dense) {
+      denseOutput();
+    }
+    if (this->storeHistory) {
+      this->history.observe(this->i, this->t_i, this->r_i);
+    }
+    for (Observer<StateType> *observer : this->observers) {
+      observer->observe(this->i, this->t_i, this->r_i);
+    }
     if (this->print) {
-      spdlog::info("\t{}\t\t{}\t\t" + this->r_n.back().toStr(), this->i,
-                   this->t_n.back());
+      spdlog::info("\t{}\t\t{}\t\t" + this->r_i.toStr(), this->i, this->t_i);
+    }
+    if constexpr (solverStatsEnabled) {
+      this->stats.acceptedSteps++;
+    }
+    if constexpr (solverTimingEnabled) {
+      // evaluations of the dense output count as evaluations
+      this->stats.outputTime +=
+          statsTimerElapsed(start) - (this->stats.evalTime - evalTime);
     }
   }
+
+private:
+  void countEvaluation(StatsClock::time_point start) {
+    if constexpr (solverStatsEnabled) {
+      this->stats.rhsEvaluations++;
+    }
+    if constexpr (solverTimingEnabled) {
+      this->stats.evalTime += statsTimerElapsed(start);
+    }
+  }
+
+  struct Event {
+    std::function<double(double, const StateType &)> g;
+    Observer<StateType> *observer;
+    bool terminal;
+    // g at the end of the last step
+    double value;
+  };
+
+  static double timeTolerance(double t) {
+    return 1e-12 * std::max(1.0, std::abs(t));
+  }
+
+  void beginStep() {
+    this->tPrevious = this->t_i;
+    this->rPrevious = this->r_i;
+    std::swap(this->fPrevious, this->fCurrent);
+    this->fPreviousValid = this->fCurrentValid;
+    this->fCurrentValid = false;
+  }
+
+  // reports the events and output times within the last step
+  void denseOutput() {
+    prepareInterpolant();
+    double tStop = this->t_i;
+    bool stop = false;
+    for (Event &e : this->events) {
+      double value = e.g(this->t_i, this->r_i);
+      if ((e.value < 0 && value >= 0) || (e.value > 0 && value <= 0)) {
+        double t = locateRoot(e, value);
+        interpolate(t, this->rDense);
+        e.observer->observe(this->i, t, this->rDense);
+        if (e.terminal && t < tStop) {
+          tStop = t;
+          stop = true;
+        }
+      }
+      e.value = value;
+    }
+    double tol = timeTolerance(tStop);
+    while (this->nextOutput < this->outputTimes.size() &&
+           this->outputTimes[this->nextOutput] <= tStop + tol) {
+      double t = this->outputTimes[this->nextOutput++];
+      interpolate(t, this->rDense);
+      this->outputObserver->observe(this->i, t, this->rDense);
+    }
+    if (stop) {
+      interpolate(tStop, this->rDense);
+      std::swap(this->r_i, this->rDense);
+      this->t_i = tStop;
+      this->tEnd = tStop;
+      this->fCurrentValid = false;
+      for (Event &e : this->events) {
+        e.value = e.g(this->t_i, this->r_i);
+      }
+      restart();
+    }
+  }
+
+  // Illinois variant of regula falsi on the interpolant of the last step, the
+  // sign of g differs at its ends
+  double locateRoot(Event &e, double value) {
+    double a = this->tPrevious, ga = e.value;
+    double b = this->t_i, gb = value;
+    double t = b;
+    int side = 0;
+    for (int k = 0; k < 100 && b - a > timeTolerance(b); k++) {
+      t = (a * gb - b * ga) / (gb - ga);
+      interpolate(t, this->rDense);
+      double gt = e.g(t, this->rDense);
+      if (gt == 0) {
+        break;
+      }
+      if ((gt > 0) == (gb > 0)) {
+        b = t;
+        gb = gt;
+        if (side == -1) {
+          ga /= 2;
+        }
+        side = -1;
+      } else {
+        a = t;
+        ga = gt;
+        if (side == 1) {
+          gb /= 2;
+        }
+        side = 1;
+      }
+    }
+    return t;
+  }
+
+  std::vector<double> outputTimes;
+  std::size_t nextOutput = 0;
+  Observer<StateType> *outputObserver = nullptr;
+  std::vector<Event> events;
+  // interpolated state passed to the output and event observers
+  StateType rDense;
 };
 
-template <typename ProblemType, typename DataType>
-class RungeKutta4 : public Solver<ProblemType, DataType> {
+// Explicit Runge-Kutta method of the constexpr Butcher tableau Tableau, see
+// ButcherTableau.h. The stages are unrolled at compile time, each one is a
+// single fused loop over the state without the zero coefficients. The
+// problem is held by its concrete type, so eval is called directly and
+// inlines into the stages, and integrate() calls step() without going
+// through the vtable.
+template <typename ProblemType, typename DataType, typename Tableau>
+class ExplicitRungeKutta : public Solver<ProblemType, DataType> {
 public:
-  RungeKutta4(){};
-  RungeKutta4(ProblemType problem) {
-    this->problemDefintion = problem;
+  using StateType = typename Solver<ProblemType, DataType>::StateType;
+  static constexpr int stages = Tableau::stages;
+  static_assert(Tableau::c[0] == 0, "explicit methods start at t_i");
+
+  ExplicitRungeKutta(){};
+  ExplicitRungeKutta(const ProblemType &problem)
+      : Solver<ProblemType, DataType>(problem){};
+  ExplicitRungeKutta(const ProblemType &problem, double dt_,
+                     int maxIteration_ = 10000)
+      : Solver<ProblemType, DataType>(problem) {
+    this->dt = dt_;
+    this->init(this->problemDefintion.t_0, this->problemDefintion.r_0);
+    this->maxI = maxIteration_;
+    this->name = Tableau::name;
+
+    int dim = this->r_i.getDim();
+    for (StateType &k_j : k) {
+      k_j.resize(dim);
+    }
+    r_tmp.resize(dim);
+  };
+
+  void step() final {
+    double h = this->nextStepSize();
+    evalStages(h, std::make_integer_sequence<int, stages>());
+    this->r_i += stageSum<stages, 0>(h);
+    this->t_i += h;
+    this->update();
+  };
+
+  void integrate() override {
+    this->run([this] { ExplicitRungeKutta::step(); });
   };
-  RungeKutta4(ProblemType problem, double dt_, int maxIteration_ = 10000) {
-    this->problemDefintion = problem;
+
+private:
+  template <int... I>
+  void evalStages(double h, std::integer_sequence<int, I...>) {
+    (evalStage<I>(h), ...);
+  };
+
+  template <int I> void evalStage(double h) {
+    if constexpr (I == 0) {
+      this->startDerivative(k[0]);
+    } else {
+      r_tmp = this->r_i + stageSum<I, 0>(h);
+      this->evalRhs(this->t_i + Tableau::c[I] * h, r_tmp, k[I]);
+    }
+  };
+
+  // a_ij, the row after the last stage holds the weights b
+  template <int Row, int J> static constexpr double coefficient() {
+    if constexpr (Row == stages) {
+      return Tableau::b[J];
+    } else {
+      return Tableau::a[Row][J];
+    }
+  };
+
+  // h sum_j coefficient<Row, j> k_j over J <= j < min(Row, stages) as a single
+  // expression, starting with the first nonzero term
+  template <int Row, int J> auto stageSum(double h) const {
+    static_assert(J < Row, "row of the tableau without nonzero entry");
+    if constexpr (coefficient<Row, J>() == 0) {
+      return stageSum<Row, J + 1>(h);
+    } else {
+      return addStages<Row, J + 1>((h * coefficient<Row, J>()) * k[J], h);
+    }
+  };
+  template <int Row, int J, typename E>
+  auto addStages(const E &sum, double h) const {
+    if constexpr (J == Row) {
+      return sum;
+    } else if constexpr (coefficient<Row, J>() == 0) {
+      return addStages<Row, J + 1>(sum, h);
+    } else {
+      return addStages<Row, J + 1>(sum + (h * coefficient<Row, J>()) * k[J],
+                                   h);
+    }
+  };
+
+  // stage workspace, sized once in the constructor
+  std::array<StateType, stages> k;
+  StateType r_tmp;
+};
+
+template <typename ProblemType, typename DataType>
+using ExplicitEuler = ExplicitRungeKutta<ProblemType, DataType, EulerTableau>;
+template <typename ProblemType, typename DataType>
+using Midpoint = ExplicitRungeKutta<ProblemType, DataType, MidpointTableau>;
+template <typename ProblemType, typename DataType>
+using Heun = ExplicitRungeKutta<ProblemType, DataType, HeunTableau>;
+template <typename ProblemType, typename DataType>
+using Kutta3 = ExplicitRungeKutta<ProblemType, DataType, Kutta3Tableau>;
+template <typename ProblemType, typename DataType>
+using RungeKutta4 =
+    ExplicitRungeKutta<ProblemType, DataType, RungeKutta4Tableau>;
+template <typename ProblemType, typename DataType>
+using RungeKutta38 =
+    ExplicitRungeKutta<ProblemType, DataType, RungeKutta38Tableau>;
+
+// Kick-drift-kick leapfrog (velocity Verlet) for second order systems, it uses
+// the split hooks evalAcceleration, drift and kick of the problem. The
+// accelerations at the end of a step are the ones at the start of the next,
+// so a step costs a single force evaluation. With order 4 a step is composed
+// of three leapfrog substeps with Yoshida's coefficients, three force
+// evaluations. Both are symplectic, the energy error oscillates but does not
+// drift.
+template <typename ProblemType, typename DataType>
+class Leapfrog : public Solver<ProblemType, DataType> {
+public:
+  using StateType = typename Solver<ProblemType, DataType>::StateType;
+
+  Leapfrog(){};
+  Leapfrog(const ProblemType &problem, double dt_, int maxIteration_ = 10000,
+           int order_ = 2)
+      : Solver<ProblemType, DataType>(problem) {
     this->dt = dt_;
-    this->r_n = {this->problemDefintion.r_0};
-    this->t_n = {this->problemDefintion.t_0};
+    this->init(this->problemDefintion.t_0, this->problemDefintion.r_0);
     this->maxI = maxIteration_;
-    this->name = "Runge Kutta 4";
+    if (order_ == 4) {
+      // Yoshida 1990, the negative middle substep cancels the third order
+      // error of the outer two
+      double w1 = 1 / (2 - std::cbrt(2.0));
+      double w0 = 1 - 2 * w1;
+      weights = {w1, w0, w1};
+      this->name = "Leapfrog Yoshida 4";
+    } else {
+      weights = {1};
+      this->name = "Leapfrog";
+    }
+    a.resize(this->r_i.getDim());
   };
 
   void step() override {
-    double t_i = this->t_n.back();
-    Vector<DataType> r_i = this->r_n.back();
-    Vector<DataType> k1 = this->problemDefintion.eval(t_i, r_i);
-    Vector<DataType> k2 = this->problemDefintion.eval(
-        t_i + this->dt / 2, r_i + (this->dt / 2) * k1);
-    Vector<DataType> k3 = this->problemDefintion.eval(
-        t_i + this->dt / 2, r_i + (this->dt / 2) * k2);
-    Vector<DataType> k4 =
-        this->problemDefintion.eval(t_i + this->dt, r_i + this->dt * k3);
-    Vector<DataType> r_j = r_i + (this->dt / 6) * (k1 + k2 * 2 + k3 * 2 + k4);
-    this->update(t_i + this->dt, r_j);
+    if (!accelerationValid) {
+      this->evalAcceleration(this->t_i, this->r_i, a);
+      accelerationValid = true;
+    }
+    if (this->dense && !this->fPreviousValid) {
+      this->problemDefintion.rhsFromAcceleration(this->r_i, a,
+                                                 this->fPrevious);
+      this->fPreviousValid = true;
+    }
+    double h = this->nextStepSize();
+    double t = this->t_i;
+    StateType &r = this->r_i;
+    for (double w : weights) {
+      double hs = w * h;
+      this->problemDefintion.kick(r, a, hs / 2);
+      this->problemDefintion.drift(r, hs);
+      t += hs;
+      this->evalAcceleration(t, r, a);
+      this->problemDefintion.kick(r, a, hs / 2);
+    }
+    this->t_i += h;
+    this->update();
     return;
   };
+
+protected:
+  // the last kick used the accelerations at the new state, with the
+  // velocities they are its derivative for the Hermite interpolant. The
+  // start of the step was set up by step()
+  void prepareInterpolant() override {
+    this->problemDefintion.rhsFromAcceleration(this->r_i, a, this->fCurrent);
+    this->fCurrentValid = true;
+  };
+  void restart() override { accelerationValid = false; };
+
+private:
+  // substep sizes as fractions of dt
+  std::vector<double> weights;
+  // accelerations at the current state
+  StateType a;
+  bool accelerationValid = false;
 };
 
+// Dormand-Prince 5(4) embedded pair with adaptive step size. The fifth order
+// solution is propagated, the difference to the embedded fourth order one
+// estimates the local error. The last stage is evaluated at the new state and
+// reused as the first stage of the next step (FSAL), so an accepted step costs
+// 6 right hand side evaluations. dt is the initial step size, if it is not
+// positive one is estimated from the problem.
 template <typename ProblemType, typename DataType>
-class ExplicitEuler : public Solver<ProblemType, DataType> {
+class DormandPrince54 : public Solver<ProblemType, DataType> {
 public:
-  ExplicitEuler(){};
-  ExplicitEuler(ProblemType problemDefintion_) {
-    this->problemDefintion = problemDefintion_;
-  };
-  ExplicitEuler(ProblemType problem, double dt_, int maxIteration_ = 10000) {
-    this->problemDefintion = problem;
+  using StateType = typename Solver<ProblemType, DataType>::StateType;
+
+  DormandPrince54(){};
+  DormandPrince54(const ProblemType &problem, double dt_,
+                  int maxIteration_ = 10000, double atol_ = 1e-6,
+                  double rtol_ = 1e-6)
+      : Solver<ProblemType, DataType>(problem), atol(atol_), rtol(rtol_) {
     this->dt = dt_;
-    this->r_n = {this->problemDefintion.r_0};
-    this->t_n = {this->problemDefintion.t_0};
+    this->init(this->problemDefintion.t_0, this->problemDefintion.r_0);
     this->maxI = maxIteration_;
-    this->name = "Explicit Euler";
+    this->name = "Dormand Prince 5(4)";
+
+    int dim = this->r_i.getDim();
+    for (StateType *k : {&k1, &k2, &k3, &k4, &k5, &k6, &k7, &r_tmp, &r_new}) {
+      k->resize(dim);
+    }
+  };
+
+  void setTolerances(double atol_, double rtol_) {
+    atol = atol_;
+    rtol = rtol_;
   };
+
+  // advances by one accepted step, retrying with smaller steps on rejection
   void step() override {
-    double t_i = this->t_n.back();
-    Vector<DataType> r_i = this->r_n.back();
-    Vector<DataType> r_j =
-        r_i + this->problemDefintion.eval(t_i, r_i) * this->dt;
-    this->update(t_i + this->dt, r_j);
-    return;
+    if (!fsalValid) {
+      this->evalRhs(this->t_i, this->r_i, k1);
+      fsalValid = true;
+      if (this->dt <= 0) {
+        this->dt = initialStepSize();
+      }
+    }
+    bool rejected = false;
+    while (true) {
+      double h = this->nextStepSize();
+      double err = attempt(h);
+      if (err <= 1) {
+        // PI controller, see Hairer, Wanner: Solving ODEs I, section II.4
+        double factor =
+            safety * std::pow(err, -alpha) * std::pow(errOld, beta);
+        factor = std::clamp(factor, minFactor, rejected ? 1.0 : maxFactor);
+        errOld = std::max(err, 1e-4);
+
+        std::swap(this->r_i, r_new);
+        std::swap(k1, k7);
+        this->t_i += h;
+        // the factor is for h. A step shortened to land on tEnd says nothing
+        // about longer ones, dt then only shrinks if even h was too long
+        this->dt = h < this->dt ? std::min(this->dt, h * factor) : h * factor;
+        this->update();
+        return;
+      }
+      rejected = true;
+      this->stepRejected();
+      // a non-finite error, e.g. from a right hand side that blew up, says
+      // nothing about the step size, shrink it as far as allowed
+      double factor = std::isfinite(err)
+                          ? std::max(minFactor, safety * std::pow(err, -alpha))
+                          : minFactor;
+      this->dt = h * factor;
+      // below a few ulps of t the steps no longer advance the solution
+      if (this->dt < 16 * std::numeric_limits<double>::epsilon() *
+                         std::max(std::abs(this->t_i),
+                                  std::numeric_limits<double>::min())) {
+        spdlog::error(this->name + ": step size too small at t = {}",
+                      this->t_i);
+        this->tEnd = this->t_i;
+        return;
+      }
+    }
   };
-};
\ No newline at end of file
+
+  // continuous extension of Dormand and Prince, fourth order: the Hermite
+  // interpolant plus a correction from the stages of the step, see Hairer,
+  // Norsett, Wanner: Solving ODEs I, section II.6
+  void interpolate(double t, StateType &out) override {
+    double h = this->t_i - this->tPrevious;
+    double s = h > 0 ? (t - this->tPrevious) / h : 1;
+    double u = 1 - s;
+    double w = s * s * (3 - 2 * s);
+    double c = h * s * s * u * u;
+    // after the step k7 holds f at its start and k1 f at its end
+    out = (1 - w) * this->rPrevious + w * this->r_i +
+          (h * s * u * u + c * d1) * k7 + (c * d3) * k3 + (c * d4) * k4 +
+          (c * d5) * k5 + (c * d6) * k6 + (c * d7 - h * s * s * u) * k1;
+  };
+
+protected:
+  // the stages are the interpolant, nothing to evaluate
+  void prepareInterpolant() override{};
+  void restart() override { fsalValid = false; };
+
+private:
+  // computes the stages for step size h, leaves the fifth order solution in
+  // r_new and returns the scaled error norm, the step is accepted if <= 1
+  double attempt(double h) {
+    double t = this->t_i;
+    const StateType &r = this->r_i;
+    r_tmp = r + (h * a21) * k1;
+    this->evalRhs(t + c2 * h, r_tmp, k2);
+    r_tmp = r + h * (a31 * k1 + a32 * k2);
+    this->evalRhs(t + c3 * h, r_tmp, k3);
+    r_tmp = r + h * (a41 * k1 + a42 * k2 + a43 * k3);
+    this->evalRhs(t + c4 * h, r_tmp, k4);
+    r_tmp = r + h * (a51 * k1 + a52 * k2 + a53 * k3 + a54 * k4);
+    this->evalRhs(t + c5 * h, r_tmp, k5);
+    r_tmp = r + h * (a61 * k1 + a62 * k2 + a63 * k3 + a64 * k4 + a65 * k5);
+    this->evalRhs(t + h, r_tmp, k6);
+    r_new = r + h * (a71 * k1 + a73 * k3 + a74 * k4 + a75 * k5 + a76 * k6);
+    this->evalRhs(t + h, r_new, k7);
+
+    double sum = 0;
+    int dim = r.getDim();
+    for (int j = 0; j < dim; j++) {
+      double e = h * (e1 * k1[j] + e3 * k3[j] + e4 * k4[j] + e5 * k5[j] +
+                      e6 * k6[j] + e7 * k7[j]);
+      double scale =
+          atol + rtol * std::max(std::abs(r[j]), std::abs(r_new[j]));
+      sum += (e / scale) * (e / scale);
+    }
+    return std::sqrt(sum / std::max(dim, 1));
+  }
+
+  // starting step size from the size of the state and its derivative
+  double initialStepSize() {
+    double d0 = 0, d1 = 0;
+    int dim = this->r_i.getDim();
+    for (int j = 0; j < dim; j++) {
+      double scale = atol + rtol * std::abs(this->r_i[j]);
+      d0 += std::pow(this->r_i[j] / scale, 2);
+      d1 += std::pow(k1[j] / scale, 2);
+    }
+    d0 = std::sqrt(d0 / dim);
+    d1 = std::sqrt(d1 / dim);
+    return (d0 < 1e-5 || d1 < 1e-5) ? 1e-6 : 0.01 * d0 / d1;
+  }
+
+  double atol = 1e-6;
+  double rtol = 1e-6;
+  double errOld = 1e-4;
+  bool fsalValid = false;
+
+  static constexpr double safety = 0.9;
+  static constexpr double minFactor = 0.2;
+  static constexpr double maxFactor = 10;
+  static constexpr double beta = 0.04;
+  static constexpr double alpha = 0.2 - 0.75 * beta;
+
+  static constexpr double c2 = 1.0 / 5, c3 = 3.0 / 10, c4 = 4.0 / 5,
+                          c5 = 8.0 / 9;
+  static constexpr double a21 = 1.0 / 5;
+  static constexpr double a31 = 3.0 / 40, a32 = 9.0 / 40;
+  static constexpr double a41 = 44.0 / 45, a42 = -56.0 / 15, a43 = 32.0 / 9;
+  static constexpr double a51 = 19372.0 / 6561, a52 = -25360.0 / 2187,
+                          a53 = 64448.0 / 6561, a54 = -212.0 / 729;
+  static constexpr double a61 = 9017.0 / 3168, a62 = -355.0 / 33,
+                          a63 = 46732.0 / 5247, a64 = 49.0 / 176,
+                          a65 = -5103.0 / 18656;
+  static constexpr double a71 = 35.0 / 384, a73 = 500.0 / 1113,
+                          a74 = 125.0 / 192, a75 = -2187.0 / 6784,
+                          a76 = 11.0 / 84;
+  // difference between the fifth and the embedded fourth order weights
+  static constexpr double e1 = 71.0 / 57600, e3 = -71.0 / 16695,
+                          e4 = 71.0 / 1920, e5 = -17253.0 / 339200,
+                          e6 = 22.0 / 525, e7 = -1.0 / 40;
+  // weights of the continuous extension
+  static constexpr double d1 = -12715105075.0 / 11282082432.0,
+                          d3 = 87487479700.0 / 32700410799.0,
+                          d4 = -10690763975.0 / 1880347072.0,
+                          d5 = 701980252875.0 / 199316789632.0,
+                          d6 = -1453857185.0 / 822651844.0,
+                          d7 = 69997945.0 / 29380423.0;
+
+  StateType k1, k2, k3, k4, k5, k6, k7, r_tmp, r_new;
+};
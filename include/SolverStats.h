@@ -0,0 +1,148 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+// ODE_SOLVER_STATS 0 removes all counting from the solvers at compile time,
+// ODE_SOLVER_TIMING 1 adds the timers. They read the clock around every
+// right hand side evaluation, which is only cheap next to expensive ones
+#ifndef ODE_SOLVER_STATS
+#define ODE_SOLVER_STATS 1
+#endif
+#ifndef ODE_SOLVER_TIMING
+#define ODE_SOLVER_TIMING 0
+#endif
+
+constexpr bool solverStatsEnabled = ODE_SOLVER_STATS;
+constexpr bool solverTimingEnabled = ODE_SOLVER_STATS && ODE_SOLVER_TIMING;
+
+// What a solver has done so far. The times split the integration into the
+// right hand side evaluations, the rest of the steps and the output: history,
+// observers, dense output and events, all in seconds
+struct SolverStats {
+  long rhsEvaluations = 0;
+  long acceptedSteps = 0;
+  long rejectedSteps = 0;
+  // heap allocations of integrate(), only counted in executables that use
+  // ODE_SOLVER_COUNT_ALLOCATIONS
+  long allocations = 0;
+  double evalTime = 0;
+  double updateTime = 0;
+  double outputTime = 0;
+
+  SolverStats &operator+=(const SolverStats &other) {
+    this->rhsEvaluations += other.rhsEvaluations;
+    this->acceptedSteps += other.acceptedSteps;
+    this->rejectedSteps += other.rejectedSteps;
+    this->allocations += other.allocations;
+    this->evalTime += other.evalTime;
+    this->updateTime += other.updateTime;
+    this->outputTime += other.outputTime;
+    return *this;
+  };
+};
+
+using StatsClock = std::chrono::steady_clock;
+
+// start of a timed section, no clock is read without the timers
+inline StatsClock::time_point statsTimerStart() {
+  if constexpr (solverTimingEnabled) {
+    return StatsClock::now();
+  }
+  return StatsClock::time_point();
+}
+inline double statsTimerElapsed(StatsClock::time_point start) {
+  if constexpr (solverTimingEnabled) {
+    return std::chrono::duration<double>(StatsClock::now() - start).count();
+  }
+  return 0;
+}
+
+// allocations of the calling thread, advanced by the replacement operator new
+// of ODE_SOLVER_COUNT_ALLOCATIONS
+inline thread_local long threadAllocations = 0;
+// set by ODE_SOLVER_COUNT_ALLOCATIONS, without it the allocations are 0
+inline bool allocationCounting = false;
+// true if SolverStats::allocations holds a count, reporters print n/a otherwise
+inline bool allocationsCounted() {
+  return solverStatsEnabled && allocationCounting;
+}
+
+// Replaces the global operator new and delete of an executable by counting
+// versions, so SolverStats::allocations is filled in. Expand it once at
+// namespace scope in a single source file of the executable. The array and
+// aligned forms are replaced too, so every allocation is counted and freed by
+// its match. None of them is inlined: GCC would otherwise see malloc paired
+// with operator delete, or operator new with free, and warn with
+// -Wmismatched-new-delete
+#define ODE_SOLVER_COUNT_ALLOCATIONS                                           \
+  static __attribute__((noinline)) void *odeSolverAllocate(                    \
+      std::size_t size) {                                                      \
+    threadAllocations++;                                                       \
+    if (void *p = std::malloc(size ? size : 1)) {                              \
+      return p;                                                                \
+    }                                                                          \
+    throw std::bad_alloc();                                                    \
+  }                                                                            \
+  static __attribute__((noinline)) void *odeSolverAllocate(                    \
+      std::size_t size, std::align_val_t al) {                                 \
+    threadAllocations++;                                                       \
+    std::size_t a = static_cast<std::size_t>(al);                              \
+    /* aligned_alloc wants a multiple of the alignment */                      \
+    std::size_t rounded = (std::max<std::size_t>(size, 1) + a - 1) / a * a;    \
+    if (void *p = std::aligned_alloc(a, rounded)) {                            \
+      return p;                                                                \
+    }                                                                          \
+    throw std::bad_alloc();                                                    \
+  }                                                                            \
+  static __attribute__((noinline)) void odeSolverFree(void *p) noexcept {      \
+    std::free(p);                                                              \
+  }                                                                            \
+  __attribute__((noinline)) void *operator new(std::size_t size) {             \
+    return odeSolverAllocate(size);                                            \
+  }                                                                            \
+  __attribute__((noinline)) void *operator new[](std::size_t size) {           \
+    return odeSolverAllocate(size);                                            \
+  }                                                                            \
+  __attribute__((noinline)) void *operator new(std::size_t size,               \
+                                               std::align_val_t al) {          \
+    return odeSolverAllocate(size, al);                                        \
+  }                                                                            \
+  __attribute__((noinline)) void *operator new[](std::size_t size,             \
+                                                 std::align_val_t al) {        \
+    return odeSolverAllocate(size, al);                                        \
+  }                                                                            \
+  __attribute__((noinline)) void operator delete(void *p) noexcept {           \
+    odeSolverFree(p);                                                          \
+  }                                                                            \
+  __attribute__((noinline)) void operator delete(void *p,                      \
+                                                 std::size_t) noexcept {       \
+    odeSolverFree(p);                                                          \
+  }                                                                            \
+  __attribute__((noinline)) void operator delete[](void *p) noexcept {         \
+    odeSolverFree(p);                                                          \
+  }                                                                            \
+  __attribute__((noinline)) void operator delete[](void *p,                    \
+                                                   std::size_t) noexcept {     \
+    odeSolverFree(p);                                                          \
+  }                                                                            \
+  __attribute__((noinline)) void operator delete(                              \
+      void *p, std::align_val_t) noexcept {                                    \
+    odeSolverFree(p);                                                          \
+  }                                                                            \
+  __attribute__((noinline)) void operator delete(                              \
+      void *p, std::size_t, std::align_val_t) noexcept {                       \
+    odeSolverFree(p);                                                          \
+  }                                                                            \
+  __attribute__((noinline)) void operator delete[](                            \
+      void *p, std::align_val_t) noexcept {                                    \
+    odeSolverFree(p);                                                          \
+  }                                                                            \
+  __attribute__((noinline)) void operator delete[](                            \
+      void *p, std::size_t, std::align_val_t) noexcept {                       \
+    odeSolverFree(p);                                                          \
+  }                                                                            \
+  static const bool odeSolverAllocationCounting = (allocationCounting = true);
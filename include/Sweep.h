@@ -0,0 +1,48 @@
+#pragma once
+
+#include "SolverStats.h"
+#include "ThreadPool.h"
+#include <utility>
+#include <vector>
+
+// outcome of one integration of a sweep
+template <typename StateType> struct SweepResult {
+  double t = 0;
+  StateType r;
+  int steps = 0;
+  SolverStats stats;
+};
+
+// Integrates makeSolver(k) for k = 0, ..., nTasks - 1 on the pool, e.g. one
+// solver per initial condition or per parameter value. makeSolver is called
+// concurrently from the worker threads and returns a ready to run solver by
+// value; only the final state is kept. Each task writes its own slot of the
+// result vector, so collecting the results needs no locking. An exception
+// thrown by makeSolver or during an integration, e.g. by an observer, is
+// rethrown here once all tasks have finished.
+template <typename SolverFactory>
+auto parallelSweep(int nTasks, SolverFactory makeSolver, ThreadPool &pool) {
+  using SolverType = decltype(makeSolver(0));
+  std::vector<SweepResult<typename SolverType::StateType>> results(nTasks);
+  for (int k = 0; k < nTasks; k++) {
+    pool.submit([&results, &makeSolver, k] {
+      SolverType solver = makeSolver(k);
+      solver.setStoreHistory(false);
+      solver.integrate();
+      auto &result = results[k];
+      result.t = solver.getT();
+      result.r = solver.getR();
+      result.steps = solver.getSteps();
+      result.stats = solver.getStats();
+    });
+  }
+  pool.wait();
+  return results;
+}
+
+// same as above on a temporary pool of nThreads workers, all cores if <= 0
+template <typename SolverFactory>
+auto parallelSweep(int nTasks, SolverFactory makeSolver, int nThreads = 0) {
+  ThreadPool pool(nThreads);
+  return parallelSweep(nTasks, std::move(makeSolver), pool);
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Fixed size thread pool with one task queue per worker. A worker takes its
+// newest task first and, once its own queue runs dry, steals the oldest task
+// of another worker. Tasks of very uneven cost (e.g. adaptive step
+// integrations) therefore keep all workers busy without a central queue.
+// An exception thrown by a task is kept and rethrown by wait().
+class ThreadPool {
+public:
+  explicit ThreadPool(int nThreads = 0) {
+    if (nThreads <= 0) {
+      nThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (int k = 0; k < nThreads; k++) {
+      queues.push_back(std::make_unique<WorkQueue>());
+    }
+    for (int k = 0; k < nThreads; k++) {
+      workers.emplace_back([this, k] { workerLoop(k); });
+    }
+  };
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(idleMutex);
+      stop = true;
+    }
+    idleCv.notify_all();
+    for (std::thread &worker : workers) {
+      worker.join();
+    }
+  };
+
+  // tasks submitted from inside a task go to the calling worker's queue,
+  // tasks from outside are spread round robin
+  void submit(std::function<void()> task) {
+    int k = currentWorker >= 0 && currentPool == this
+                ? currentWorker
+                : nextQueue++ % queues.size();
+    pending++;
+    {
+      std::lock_guard<std::mutex> lock(queues[k]->mutex);
+      queues[k]->tasks.push_back(std::move(task));
+    }
+    {
+      std::lock_guard<std::mutex> lock(idleMutex);
+      queued++;
+    }
+    idleCv.notify_one();
+  };
+
+  // blocks until every submitted task has finished, then rethrows the first
+  // exception a task has thrown since the last wait. The other tasks still
+  // run to completion
+  void wait() {
+    std::unique_lock<std::mutex> lock(idleMutex);
+    doneCv.wait(lock, [this] { return pending == 0; });
+    if (error) {
+      std::rethrow_exception(std::exchange(error, nullptr));
+    }
+  };
+
+  int size() const { return workers.size(); };
+
+private:
+  struct WorkQueue {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  bool popLocal(int k, std::function<void()> &task) {
+    std::lock_guard<std::mutex> lock(queues[k]->mutex);
+    if (queues[k]->tasks.empty()) {
+      return false;
+    }
+    task = std::move(queues[k]->tasks.back());
+    queues[k]->tasks.pop_back();
+    return true;
+  };
+
+  bool steal(int thief, std::function<void()> &task) {
+    int n = queues.size();
+    for (int offset = 1; offset < n; offset++) {
+      WorkQueue &victim = *queues[(thief + offset) % n];
+      std::lock_guard<std::mutex> lock(victim.mutex);
+      if (!victim.tasks.empty()) {
+        task = std::move(victim.tasks.front());
+        victim.tasks.pop_front();
+        return true;
+      }
+    }
+    return false;
+  };
+
+  void workerLoop(int k) {
+    currentWorker = k;
+    currentPool = this;
+    std::function<void()> task;
+    while (true) {
+      if (popLocal(k, task) || steal(k, task)) {
+        {
+          std::lock_guard<std::mutex> lock(idleMutex);
+          queued--;
+        }
+        try {
+          task();
+        } catch (...) {
+          std::lock_guard<std::mutex> lock(idleMutex);
+          if (!error) {
+            error = std::current_exception();
+          }
+        }
+        task = nullptr;
+        if (--pending == 0) {
+          std::lock_guard<std::mutex> lock(idleMutex);
+          doneCv.notify_all();
+        }
+        continue;
+      }
+      std::unique_lock<std::mutex> lock(idleMutex);
+      idleCv.wait(lock, [this] { return stop || queued > 0; });
+      if (stop && queued == 0) {
+        return;
+      }
+    }
+  };
+
+  std::vector<std::unique_ptr<WorkQueue>> queues;
+  std::vector<std::thread> workers;
+  std::atomic<unsigned> nextQueue{0};
+  // submitted but not yet finished tasks
+  std::atomic<long> pending{0};
+  // tasks waiting in a queue, guarded by idleMutex
+  long queued = 0;
+  bool stop = false;
+  // first exception of a task since the last wait, guarded by idleMutex
+  std::exception_ptr error;
+  std::mutex idleMutex;
+  std::condition_variable idleCv;
+  std::condition_variable doneCv;
+
+  static inline thread_local int currentWorker = -1;
+  static inline thread_local ThreadPool *currentPool = nullptr;
+};
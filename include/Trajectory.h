@@ -0,0 +1,201 @@
+#pragma once
+
+#include "Observer.h"
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Trajectory file layout, all numbers in native byte order:
+//   header      TrajectoryHeader, 256 bytes
+//   records     nRecords records of recordSize bytes: t as a double followed
+//               by the dim elements of the state
+//   index       t of every indexStride-th record, nRecords / indexStride
+//               rounded up doubles at indexOffset, a multiple of 8
+// The header is written with the first record and completed, together with
+// the index, when the writer is closed. A file whose writer did not finish
+// has indexOffset 0, its records are still readable, as are those of a
+// file cut short after closing.
+struct TrajectoryHeader {
+  char magic[8];
+  std::uint32_t version;
+  // element type of the state, see TrajectoryDtype
+  std::uint32_t dtype;
+  std::uint64_t dim;
+  std::uint64_t elementSize;
+  std::uint64_t recordSize;
+  std::uint64_t nRecords;
+  std::uint64_t indexOffset;
+  std::uint64_t indexStride;
+  char solver[64];
+  char description[64];
+  char reserved[64];
+};
+static_assert(sizeof(TrajectoryHeader) == 256, "trajectory header size");
+
+enum class TrajectoryDtype : std::uint32_t {
+  RAW = 0,
+  FLOAT64 = 1,
+  FLOAT32 = 2
+};
+
+constexpr char trajectoryMagic[8] = {'O', 'D', 'E', 'T', 'R', 'A', 'J', 0};
+constexpr std::uint32_t trajectoryVersion = 1;
+
+// Observer writing the trajectory format above through the buffered, optionally
+// asynchronous, BinaryFileWriter. solver and description are stored in the
+// header, e.g. the solver's getName() and the problem parameters
+template <typename StateType>
+class TrajectoryWriter : public BinaryFileWriter<StateType> {
+public:
+  TrajectoryWriter(const std::string &path, const std::string &solver_ = "",
+                   const std::string &description_ = "", bool async_ = false,
+                   int indexStride_ = 1024)
+      : BinaryFileWriter<StateType>(path, async_), solver(solver_),
+        description(description_), indexStride(std::max(indexStride_, 1)){};
+  ~TrajectoryWriter() { close(); };
+
+  void observe(int step, double t, const StateType &r) override {
+    using ValueType = std::remove_cv_t<std::remove_reference_t<decltype(r[0])>>;
+    // a record after the index would corrupt the file
+    if (this->closed) {
+      if (!this->warnedClosed) {
+        spdlog::warn("{} is closed, dropping the state at t = {}",
+                     this->path, t);
+        this->warnedClosed = true;
+      }
+      return;
+    }
+    if (this->nRecords == 0) {
+      initHeader(r.getDim(), sizeof(ValueType), dtypeOf<ValueType>());
+      this->append(&this->header, sizeof(TrajectoryHeader));
+    }
+    assert(static_cast<std::uint64_t>(r.getDim()) == this->header.dim);
+    if (this->nRecords % this->indexStride == 0) {
+      this->index.push_back(t);
+    }
+    BinaryFileWriter<StateType>::observe(step, t, r);
+    this->nRecords++;
+  };
+
+  // writes the index and completes the header, no records may follow
+  void close() {
+    if (this->closed || this->nRecords == 0) {
+      this->closed = true;
+      return;
+    }
+    this->closed = true;
+    // the index starts on the next multiple of 8 bytes
+    std::uint64_t end =
+        sizeof(TrajectoryHeader) + this->nRecords * this->header.recordSize;
+    std::uint64_t padding = (8 - end % 8) % 8;
+    const char zeros[8] = {};
+    this->append(zeros, padding);
+    this->header.nRecords = this->nRecords;
+    this->header.indexOffset = end + padding;
+    this->append(this->index.data(), this->index.size() * sizeof(double));
+    this->flush();
+    // the writer thread is idle after flush, the stream can be repositioned
+    this->file.seekp(0);
+    this->file.write(reinterpret_cast<const char *>(&this->header),
+                     sizeof(TrajectoryHeader));
+    this->file.seekp(0, std::ios::end);
+    this->file.flush();
+    this->checkStream();
+  };
+
+private:
+  template <typename T> static TrajectoryDtype dtypeOf() {
+    if constexpr (std::is_same_v<T, double>) {
+      return TrajectoryDtype::FLOAT64;
+    } else if constexpr (std::is_same_v<T, float>) {
+      return TrajectoryDtype::FLOAT32;
+    }
+    return TrajectoryDtype::RAW;
+  };
+
+  void initHeader(int dim, std::size_t elementSize, TrajectoryDtype dtype) {
+    std::memset(&this->header, 0, sizeof(TrajectoryHeader));
+    std::memcpy(this->header.magic, trajectoryMagic, sizeof(trajectoryMagic));
+    this->header.version = trajectoryVersion;
+    this->header.dtype = static_cast<std::uint32_t>(dtype);
+    this->header.dim = dim;
+    this->header.elementSize = elementSize;
+    this->header.recordSize = sizeof(double) + dim * elementSize;
+    this->header.indexStride = this->indexStride;
+    std::strncpy(this->header.solver, this->solver.c_str(),
+                 sizeof(this->header.solver) - 1);
+    std::strncpy(this->header.description, this->description.c_str(),
+                 sizeof(this->header.description) - 1);
+  };
+
+  std::string solver, description;
+  std::uint64_t indexStride;
+  std::uint64_t nRecords = 0;
+  std::vector<double> index;
+  TrajectoryHeader header;
+  bool closed = false;
+  bool warnedClosed = false;
+};
+
+// Read only view of a trajectory file mapped into memory. States are
+// accessed in place without copying, the operating system pages in only the
+// parts of the file that are touched
+class TrajectoryReader {
+public:
+  // throws std::runtime_error if the file cannot be mapped or is no trajectory
+  TrajectoryReader(const std::string &path);
+  TrajectoryReader(const TrajectoryReader &) = delete;
+  TrajectoryReader &operator=(const TrajectoryReader &) = delete;
+  ~TrajectoryReader();
+
+  const TrajectoryHeader &getHeader() const { return *this->header; };
+  int getDim() const { return this->header->dim; };
+  long size() const { return this->nRecords; };
+  // false if the writer was not closed or the file was cut short, the file
+  // then has no index and holds the records written entirely
+  bool isComplete() const { return this->complete; };
+  std::string getSolver() const { return this->header->solver; };
+  std::string getDescription() const { return this->header->description; };
+
+  double getT(long k) const {
+    double t;
+    std::memcpy(&t, record(k), sizeof(double));
+    return t;
+  };
+  // pointer into the mapping to the dim elements of record k, T has to match
+  // the element type of the writer
+  template <typename T> const T *getState(long k) const {
+    assert(sizeof(T) == this->header->elementSize);
+    return reinterpret_cast<const T *>(record(k) + sizeof(double));
+  };
+  // copies record k into r, e.g. to restart a run from it
+  template <typename StateType> void loadState(long k, StateType &r) const {
+    using ValueType = std::remove_cv_t<std::remove_reference_t<decltype(r[0])>>;
+    if (r.getDim() != getDim()) {
+      r.resize(getDim());
+    }
+    std::memcpy(&r[0], getState<ValueType>(k), getDim() * sizeof(ValueType));
+  };
+
+  // last record with t_k <= t, 0 if t lies before the first record. The
+  // index narrows the search to indexStride records, so a lookup touches a
+  // single block of the file
+  long find(double t) const;
+
+private:
+  const char *record(long k) const {
+    return this->data + sizeof(TrajectoryHeader) +
+           k * this->header->recordSize;
+  };
+
+  const char *data = nullptr;
+  std::size_t length = 0;
+  const TrajectoryHeader *header = nullptr;
+  const double *index = nullptr;
+  long nRecords = 0;
+  long nIndex = 0;
+  bool complete = false;
+};
@@ -0,0 +1,217 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <initializer_list>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Vector arithmetic is evaluated lazily: a + b, s * a, ... build lightweight
+// expression nodes and nothing is computed until the expression is assigned
+// to a Vector. Any linear combination of vectors and scalars therefore runs as
+// a single loop writing straight into the destination, without temporaries.
+template <typename E> struct VectorExpr {
+  const E &self() const { return static_cast<const E &>(*this); }
+  int getDim() const { return self().getDim(); }
+  auto operator[](int index) const { return self()[index]; }
+};
+
+// numbers are printed with std::to_string, other elements need a toStr()
+template <typename T> std::string elementToStr(const T &value) {
+  if constexpr (std::is_arithmetic_v<T>) {
+    return std::to_string(value);
+  } else {
+    return value.toStr();
+  }
+}
+
+// dimension tag of vectors whose size is only known at runtime
+constexpr int Dynamic = -1;
+
+// Vector<T> owns a heap buffer sized at runtime, for large systems.
+// Vector<T, N> keeps its N elements inline, so small states live on the stack
+// (or in registers) and every operation is unrolled at compile time.
+template <typename T, int N = Dynamic> class Vector;
+
+template <typename T, int N> struct VectorStorage {
+  void resize(int dim_) { assert(dim_ == N); }
+  constexpr int size() const { return N; }
+  T *data() { return this->elements.data(); }
+  const T *data() const { return this->elements.data(); }
+
+  std::array<T, N> elements{};
+};
+
+template <typename T> struct VectorStorage<T, Dynamic> {
+  void resize(int dim_) { this->elements.resize(dim_); }
+  int size() const { return this->elements.size(); }
+  T *data() { return this->elements.data(); }
+  const T *data() const { return this->elements.data(); }
+
+  std::vector<T> elements;
+};
+
+// Vectors are captured by reference, intermediate expression nodes by value
+// since they are temporaries of the enclosing full expression
+template <typename E> struct ExprOperand { using type = const E; };
+template <typename T, int N> struct ExprOperand<Vector<T, N>> {
+  using type = const Vector<T, N> &;
+};
+
+template <typename L, typename R>
+class VectorSum : public VectorExpr<VectorSum<L, R>> {
+public:
+  VectorSum(const L &l_, const R &r_) : l(l_), r(r_) {
+    assert(l.getDim() == r.getDim());
+  }
+  int getDim() const { return l.getDim(); }
+  auto operator[](int index) const { return l[index] + r[index]; }
+
+private:
+  typename ExprOperand<L>::type l;
+  typename ExprOperand<R>::type r;
+};
+
+template <typename L, typename R>
+class VectorDiff : public VectorExpr<VectorDiff<L, R>> {
+public:
+  VectorDiff(const L &l_, const R &r_) : l(l_), r(r_) {
+    assert(l.getDim() == r.getDim());
+  }
+  int getDim() const { return l.getDim(); }
+  auto operator[](int index) const { return l[index] - r[index]; }
+
+private:
+  typename ExprOperand<L>::type l;
+  typename ExprOperand<R>::type r;
+};
+
+template <typename E> class VectorScaled : public VectorExpr<VectorScaled<E>> {
+public:
+  VectorScaled(double scalar_, const E &e_) : scalar(scalar_), e(e_) {}
+  int getDim() const { return e.getDim(); }
+  auto operator[](int index) const { return e[index] * scalar; }
+
+private:
+  double scalar;
+  typename ExprOperand<E>::type e;
+};
+
+template <typename L, typename R>
+VectorSum<L, R> operator+(const VectorExpr<L> &l, const VectorExpr<R> &r) {
+  return VectorSum<L, R>(l.self(), r.self());
+}
+
+template <typename L, typename R>
+VectorDiff<L, R> operator-(const VectorExpr<L> &l, const VectorExpr<R> &r) {
+  return VectorDiff<L, R>(l.self(), r.self());
+}
+
+template <typename E>
+VectorScaled<E> operator-(const VectorExpr<E> &e) {
+  return VectorScaled<E>(-1, e.self());
+}
+
+template <typename E>
+VectorScaled<E> operator*(const VectorExpr<E> &e, const double &scalar) {
+  return VectorScaled<E>(scalar, e.self());
+}
+
+template <typename E>
+VectorScaled<E> operator*(const double &scalar, const VectorExpr<E> &e) {
+  return VectorScaled<E>(scalar, e.self());
+}
+
+template <typename E>
+VectorScaled<E> operator/(const VectorExpr<E> &e, const double &scalar) {
+  return VectorScaled<E>(1 / scalar, e.self());
+}
+
+template <typename E>
+VectorScaled<E> operator/(const double &scalar, const VectorExpr<E> &e) {
+  return e / scalar;
+}
+
+template <typename T, int N> class Vector : public VectorExpr<Vector<T, N>> {
+public:
+  Vector(int dim_) { this->storage.resize(dim_); }
+  Vector(std::vector<T> &data_) {
+    this->storage.resize(data_.size());
+    std::copy(data_.begin(), data_.end(), this->storage.data());
+  }
+  Vector(std::initializer_list<T> data_) {
+    this->storage.resize(data_.size());
+    std::copy(data_.begin(), data_.end(), this->storage.data());
+  }
+  Vector() = default;
+  Vector(const Vector &other) = default;
+  Vector(Vector &&other) = default;
+  template <typename E> Vector(const VectorExpr<E> &expr) { *this = expr; }
+
+  // copy assignment reuses the existing buffer when the dimensions match, so
+  // assigning into preallocated workspace vectors does not allocate
+  Vector &operator=(const Vector &other) = default;
+  Vector &operator=(Vector &&other) = default;
+
+  // evaluates the whole expression in one pass. Every node only reads the
+  // element it writes, so the destination may appear on the right hand side
+  template <typename E> Vector &operator=(const VectorExpr<E> &expr) {
+    const E &e = expr.self();
+    if constexpr (N != Dynamic && N <= maxUnrolledDim) {
+      assignUnrolled(e, std::make_index_sequence<N>());
+    } else {
+      if (e.getDim() != getDim()) {
+        resize(e.getDim());
+      }
+      T *d = this->storage.data();
+      int dim = getDim();
+      for (int i = 0; i < dim; i++) {
+        d[i] = e[i];
+      }
+    }
+    return *this;
+  }
+  template <typename E> Vector &operator+=(const VectorExpr<E> &expr) {
+    return *this = *this + expr;
+  }
+  template <typename E> Vector &operator-=(const VectorExpr<E> &expr) {
+    return *this = *this - expr;
+  }
+  Vector &operator*=(const double &scalar) { return *this = *this * scalar; }
+
+  void resize(int dim_) { this->storage.resize(dim_); }
+
+  T &operator[](int index) { return this->storage.elements[index]; }
+  const T &operator[](int index) const {
+    return this->storage.elements[index];
+  }
+  T getX() const { return (*this)[0]; };
+  T getY() const { return (*this)[1]; };
+  T getZ() const { return (*this)[2]; };
+
+  int getDim() const { return this->storage.size(); }
+
+  std::string toStr() const {
+    std::string res = "[ ";
+    for (int i = 0; i < getDim() - 1; i++) {
+      res += elementToStr((*this)[i]) + ", ";
+    }
+    res += elementToStr((*this)[getDim() - 1]) + " ]";
+    return res;
+  };
+
+private:
+  static constexpr int maxUnrolledDim = 16;
+
+  template <typename E, std::size_t... I>
+  void assignUnrolled(const E &e, std::index_sequence<I...>) {
+    assert(e.getDim() == N);
+    T *d = this->storage.data();
+    ((d[I] = e[I]), ...);
+  }
+
+  VectorStorage<T, N> storage;
+};
@@ -0,0 +1,84 @@
+#include <Matrix.h>
+
+#include <algorithm>
+#include <cmath>
+
+void Matrix::resize(int n_, int lower_, int upper_) {
+  this->n = n_;
+  this->kl = (lower_ < 0 || lower_ > n_ - 1) ? std::max(n_ - 1, 0) : lower_;
+  this->ku = (upper_ < 0 || upper_ > n_ - 1) ? std::max(n_ - 1, 0) : upper_;
+  this->width = std::min(n_, 2 * this->kl + this->ku + 1);
+  this->values.assign(this->n * this->width, 0.0);
+  this->pivots.resize(this->n);
+}
+
+void Matrix::setZero() {
+  std::fill(this->values.begin(), this->values.end(), 0.0);
+}
+
+void Matrix::scaleAndAddIdentity(double scale) {
+  for (int i = 0; i < this->n; i++) {
+    int jEnd = std::min(this->n - 1, i + this->ku);
+    for (int j = std::max(0, i - this->kl); j <= jEnd; j++) {
+      (*this)(i, j) *= scale;
+    }
+    (*this)(i, i) += 1;
+  }
+}
+
+// Gaussian elimination by columns as in LINPACK's dgbfa. Row interchanges are
+// applied to the columns right of the pivot only, the multipliers of earlier
+// columns stay where they were computed and solve replays the interchanges
+bool Matrix::factorize() {
+  Matrix &a = *this;
+  for (int k = 0; k < this->n; k++) {
+    int iEnd = std::min(this->n - 1, k + this->kl);
+    int jEnd = std::min(this->n - 1, k + this->kl + this->ku);
+    int p = k;
+    for (int i = k + 1; i <= iEnd; i++) {
+      if (std::abs(a(i, k)) > std::abs(a(p, k))) {
+        p = i;
+      }
+    }
+    this->pivots[k] = p;
+    if (a(p, k) == 0) {
+      return false;
+    }
+    if (p != k) {
+      for (int j = k; j <= jEnd; j++) {
+        std::swap(a(k, j), a(p, j));
+      }
+    }
+    double inv = 1 / a(k, k);
+    for (int i = k + 1; i <= iEnd; i++) {
+      double l = a(i, k) * inv;
+      a(i, k) = l;
+      if (l == 0) {
+        continue;
+      }
+      for (int j = k + 1; j <= jEnd; j++) {
+        a(i, j) -= l * a(k, j);
+      }
+    }
+  }
+  return true;
+}
+
+void Matrix::solve(double *b) const {
+  const Matrix &a = *this;
+  for (int k = 0; k < this->n; k++) {
+    std::swap(b[k], b[this->pivots[k]]);
+    int iEnd = std::min(this->n - 1, k + this->kl);
+    for (int i = k + 1; i <= iEnd; i++) {
+      b[i] -= a(i, k) * b[k];
+    }
+  }
+  for (int i = this->n - 1; i >= 0; i--) {
+    int jEnd = std::min(this->n - 1, i + this->kl + this->ku);
+    double s = b[i];
+    for (int j = i + 1; j <= jEnd; j++) {
+      s -= a(i, j) * b[j];
+    }
+    b[i] = s / a(i, i);
+  }
+}
@@ -0,0 +1,276 @@
+#include <Particles.h>
+#include <Problem.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PARTICLES_X86_SIMD
+#include <immintrin.h>
+#endif
+
+void ParticleSystem::resize(int n) {
+  for (AlignedVector<double> *v :
+       {&this->x, &this->y, &this->vx, &this->vy, &this->m, &this->ax,
+        &this->ay}) {
+    v->resize(n);
+  }
+}
+
+void ParticleSystem::load(const Vector<Body> &bodies) {
+  int n = bodies.getDim();
+  resize(n);
+  for (int i = 0; i < n; i++) {
+    this->x[i] = bodies[i].position[0];
+    this->y[i] = bodies[i].position[1];
+    this->vx[i] = bodies[i].velocity[0];
+    this->vy[i] = bodies[i].velocity[1];
+    this->m[i] = bodies[i].mass;
+  }
+}
+
+void ParticleSystem::store(Vector<Body> &bodies) const {
+  int n = size();
+  bodies.resize(n);
+  for (int i = 0; i < n; i++) {
+    bodies[i].position[0] = this->x[i];
+    bodies[i].position[1] = this->y[i];
+    bodies[i].velocity[0] = this->vx[i];
+    bodies[i].velocity[1] = this->vy[i];
+    bodies[i].mass = this->m[i];
+  }
+}
+
+void computeAccelerationsReference(ParticleSystem &p, double gravity,
+                                   double softening) {
+  int n = p.size();
+  double eps2 = softening * softening;
+  std::fill(p.ax.begin(), p.ax.end(), 0.0);
+  std::fill(p.ay.begin(), p.ay.end(), 0.0);
+  for (int i = 0; i < n; i++) {
+    for (int j = i + 1; j < n; j++) {
+      double dx = p.x[j] - p.x[i];
+      double dy = p.y[j] - p.y[i];
+      double d2 = dx * dx + dy * dy + eps2;
+      if (d2 == 0) {
+        continue;
+      }
+      double invD = 1 / std::sqrt(d2);
+      double s = gravity * invD * invD * invD;
+      p.ax[i] += p.m[j] * s * dx;
+      p.ay[i] += p.m[j] * s * dy;
+      p.ax[j] -= p.m[i] * s * dx;
+      p.ay[j] -= p.m[i] * s * dy;
+    }
+  }
+}
+
+namespace {
+
+// particles per tile, five arrays of a tile take 10 kB
+constexpr int tileSize = 256;
+
+// interactions of particle i with particles [j, jEnd), the scalar remainder
+// of the SIMD kernels and the body of the scalar kernel
+inline void interactScalar(const double *__restrict x,
+                           const double *__restrict y,
+                           const double *__restrict m, double *__restrict ax,
+                           double *__restrict ay, int i, int j, int jEnd,
+                           double gravity, double eps2, double &axi,
+                           double &ayi) {
+  double xi = x[i], yi = y[i], mi = m[i];
+  for (; j < jEnd; j++) {
+    double dx = x[j] - xi;
+    double dy = y[j] - yi;
+    double d2 = dx * dx + dy * dy + eps2;
+    if (d2 == 0) {
+      continue;
+    }
+    double invD = 1 / std::sqrt(d2);
+    double s = gravity * invD * invD * invD;
+    axi += m[j] * s * dx;
+    ayi += m[j] * s * dy;
+    ax[j] -= mi * s * dx;
+    ay[j] -= mi * s * dy;
+  }
+}
+
+void rowScalar(const double *__restrict x, const double *__restrict y,
+               const double *__restrict m, double *__restrict ax,
+               double *__restrict ay, int i, int j, int jEnd, double gravity,
+               double eps2) {
+  double axi = 0, ayi = 0;
+  interactScalar(x, y, m, ax, ay, i, j, jEnd, gravity, eps2, axi, ayi);
+  ax[i] += axi;
+  ay[i] += ayi;
+}
+
+#ifdef PARTICLES_X86_SIMD
+
+// the row kernels carry the target attribute themselves, a lambda calling
+// them does not inherit it
+__attribute__((target("avx2,fma"))) void
+rowAvx2(const double *__restrict x, const double *__restrict y,
+        const double *__restrict m, double *__restrict ax,
+        double *__restrict ay, int i, int j, int jEnd, double gravity,
+        double eps2) {
+  const __m256d vEps2 = _mm256_set1_pd(eps2);
+  const __m256d vG = _mm256_set1_pd(gravity);
+  const __m256d half = _mm256_set1_pd(0.5);
+  const __m256d threeHalf = _mm256_set1_pd(1.5);
+  const __m256d floatMin = _mm256_set1_pd(std::numeric_limits<float>::min());
+  const __m256d floatMax = _mm256_set1_pd(std::numeric_limits<float>::max());
+  const __m256d xi = _mm256_set1_pd(x[i]);
+  const __m256d yi = _mm256_set1_pd(y[i]);
+  const __m256d mi = _mm256_set1_pd(m[i]);
+  __m256d axi = _mm256_setzero_pd(), ayi = _mm256_setzero_pd();
+  for (; j + 4 <= jEnd; j += 4) {
+    __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(x + j), xi);
+    __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(y + j), yi);
+    __m256d d2 = _mm256_fmadd_pd(dx, dx, _mm256_fmadd_pd(dy, dy, vEps2));
+    __m256d invD;
+    // the estimate goes through single precision, outside its normal range
+    // d2 becomes inf or 0 and the Newton steps cannot recover
+    __m256d inRange = _mm256_and_pd(_mm256_cmp_pd(d2, floatMin, _CMP_GE_OQ),
+                                    _mm256_cmp_pd(d2, floatMax, _CMP_LE_OQ));
+    if (_mm256_movemask_pd(inRange) == 0xf) {
+      // single precision estimate, two Newton steps y (1.5 - 0.5 d2 y^2)
+      invD = _mm256_cvtps_pd(_mm_rsqrt_ps(_mm256_cvtpd_ps(d2)));
+      __m256d halfD2 = _mm256_mul_pd(half, d2);
+      for (int k = 0; k < 2; k++) {
+        __m256d yy = _mm256_mul_pd(invD, invD);
+        invD = _mm256_mul_pd(invD, _mm256_fnmadd_pd(halfD2, yy, threeHalf));
+      }
+    } else {
+      invD = _mm256_div_pd(_mm256_set1_pd(1), _mm256_sqrt_pd(d2));
+    }
+    // coincident particles without softening exert no force, 0 instead of
+    // inf * 0
+    __m256d s = _mm256_and_pd(
+        _mm256_mul_pd(vG, _mm256_mul_pd(invD, _mm256_mul_pd(invD, invD))),
+        _mm256_cmp_pd(d2, _mm256_setzero_pd(), _CMP_NEQ_OQ));
+    __m256d mjs = _mm256_mul_pd(_mm256_loadu_pd(m + j), s);
+    __m256d mis = _mm256_mul_pd(mi, s);
+    axi = _mm256_fmadd_pd(mjs, dx, axi);
+    ayi = _mm256_fmadd_pd(mjs, dy, ayi);
+    _mm256_storeu_pd(ax + j,
+                     _mm256_fnmadd_pd(mis, dx, _mm256_loadu_pd(ax + j)));
+    _mm256_storeu_pd(ay + j,
+                     _mm256_fnmadd_pd(mis, dy, _mm256_loadu_pd(ay + j)));
+  }
+  alignas(32) double sx[4], sy[4];
+  _mm256_store_pd(sx, axi);
+  _mm256_store_pd(sy, ayi);
+  double axs = sx[0] + sx[1] + sx[2] + sx[3];
+  double ays = sy[0] + sy[1] + sy[2] + sy[3];
+  interactScalar(x, y, m, ax, ay, i, j, jEnd, gravity, eps2, axs, ays);
+  ax[i] += axs;
+  ay[i] += ays;
+}
+
+__attribute__((target("avx512f"))) void
+rowAvx512(const double *__restrict x, const double *__restrict y,
+          const double *__restrict m, double *__restrict ax,
+          double *__restrict ay, int i, int j, int jEnd, double gravity,
+          double eps2) {
+  const __m512d vEps2 = _mm512_set1_pd(eps2);
+  const __m512d vG = _mm512_set1_pd(gravity);
+  const __m512d half = _mm512_set1_pd(0.5);
+  const __m512d threeHalf = _mm512_set1_pd(1.5);
+  const __m512d xi = _mm512_set1_pd(x[i]);
+  const __m512d yi = _mm512_set1_pd(y[i]);
+  const __m512d mi = _mm512_set1_pd(m[i]);
+  __m512d axi = _mm512_setzero_pd(), ayi = _mm512_setzero_pd();
+  for (; j + 8 <= jEnd; j += 8) {
+    __m512d dx = _mm512_sub_pd(_mm512_loadu_pd(x + j), xi);
+    __m512d dy = _mm512_sub_pd(_mm512_loadu_pd(y + j), yi);
+    __m512d d2 = _mm512_fmadd_pd(dx, dx, _mm512_fmadd_pd(dy, dy, vEps2));
+    // 14 bit estimate, two Newton steps y (1.5 - 0.5 d2 y^2)
+    __m512d invD = _mm512_rsqrt14_pd(d2);
+    __m512d halfD2 = _mm512_mul_pd(half, d2);
+    for (int k = 0; k < 2; k++) {
+      __m512d yy = _mm512_mul_pd(invD, invD);
+      invD = _mm512_mul_pd(invD, _mm512_fnmadd_pd(halfD2, yy, threeHalf));
+    }
+    __m512d s = _mm512_maskz_mul_pd(
+        _mm512_cmp_pd_mask(d2, _mm512_setzero_pd(), _CMP_NEQ_OQ), vG,
+        _mm512_mul_pd(invD, _mm512_mul_pd(invD, invD)));
+    __m512d mjs = _mm512_mul_pd(_mm512_loadu_pd(m + j), s);
+    __m512d mis = _mm512_mul_pd(mi, s);
+    axi = _mm512_fmadd_pd(mjs, dx, axi);
+    ayi = _mm512_fmadd_pd(mjs, dy, ayi);
+    _mm512_storeu_pd(ax + j,
+                     _mm512_fnmadd_pd(mis, dx, _mm512_loadu_pd(ax + j)));
+    _mm512_storeu_pd(ay + j,
+                     _mm512_fnmadd_pd(mis, dy, _mm512_loadu_pd(ay + j)));
+  }
+  double axs = _mm512_reduce_add_pd(axi);
+  double ays = _mm512_reduce_add_pd(ayi);
+  interactScalar(x, y, m, ax, ay, i, j, jEnd, gravity, eps2, axs, ays);
+  ax[i] += axs;
+  ay[i] += ays;
+}
+
+#endif
+
+using RowKernel = void (*)(const double *, const double *, const double *,
+                           double *, double *, int, int, int, double, double);
+
+// Loops over pairs of tiles (I, J >= I) and calls row for every i of I with
+// the part of J above the diagonal
+void forEachTilePair(ParticleSystem &p, RowKernel row, double gravity,
+                     double eps2) {
+  int n = p.size();
+  for (int tileI = 0; tileI < n; tileI += tileSize) {
+    int endI = std::min(tileI + tileSize, n);
+    for (int tileJ = tileI; tileJ < n; tileJ += tileSize) {
+      int endJ = std::min(tileJ + tileSize, n);
+      for (int i = tileI; i < endI; i++) {
+        row(p.x.data(), p.y.data(), p.m.data(), p.ax.data(), p.ay.data(), i,
+            std::max(tileJ, i + 1), endJ, gravity, eps2);
+      }
+    }
+  }
+}
+
+} // namespace
+
+SimdLevel bestSimdLevel() {
+#ifdef PARTICLES_X86_SIMD
+  if (__builtin_cpu_supports("avx512f")) {
+    return SimdLevel::AVX512;
+  }
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+    return SimdLevel::AVX2;
+  }
+#endif
+  return SimdLevel::SCALAR;
+}
+
+const char *simdLevelName(SimdLevel level) {
+  switch (level) {
+  case SimdLevel::AVX512:
+    return "AVX-512";
+  case SimdLevel::AVX2:
+    return "AVX2";
+  default:
+    return "scalar";
+  }
+}
+
+void computeAccelerations(ParticleSystem &p, double gravity, double softening,
+                          SimdLevel level) {
+  double eps2 = softening * softening;
+  std::fill(p.ax.begin(), p.ax.end(), 0.0);
+  std::fill(p.ay.begin(), p.ay.end(), 0.0);
+  RowKernel row = rowScalar;
+#ifdef PARTICLES_X86_SIMD
+  if (level == SimdLevel::AVX512) {
+    row = rowAvx512;
+  } else if (level == SimdLevel::AVX2) {
+    row = rowAvx2;
+  }
+#endif
+  forEachTilePair(p, row, gravity, eps2);
+}
@@ -1,5 +1,261 @@
 #include <Problem.h>
 
+#include <algorithm>
+#include <cmath>
+
 Vector<Body> N_Body::eval(double t_i, const Vector<Body> &r_i) {
-  return Vector<Body>(0);
+  Vector<Body> out(r_i.getDim());
+  eval(t_i, r_i, out);
+  return out;
+}
+
+void N_Body::eval(double t_i, const Vector<Body> &r_i, Vector<Body> &out) {
+  evalAcceleration(t_i, r_i, out);
+  rhsFromAcceleration(r_i, out, out);
+}
+
+void N_Body::evalAcceleration(double t_i, const Vector<Body> &r_i,
+                              Vector<Body> &a) {
+  int n = r_i.getDim();
+  if (a.getDim() != n) {
+    a.resize(n);
+  }
+  for (int i = 0; i < n; i++) {
+    a[i].velocity[0] = 0;
+    a[i].velocity[1] = 0;
+  }
+  if (this->method == BARNES_HUT) {
+    accelerationsBarnesHut(r_i, a);
+  } else if (this->method == DIRECT_SIMD) {
+    this->particles.load(r_i);
+    computeAccelerations(this->particles, this->gravity, this->softening);
+    for (int i = 0; i < n; i++) {
+      a[i].velocity[0] = this->particles.ax[i];
+      a[i].velocity[1] = this->particles.ay[i];
+    }
+  } else {
+    accelerationsDirect(r_i, a);
+  }
+}
+
+void N_Body::drift(Vector<Body> &r_i, double h) {
+  for (int i = 0; i < r_i.getDim(); i++) {
+    r_i[i].position += h * r_i[i].velocity;
+  }
+}
+
+void N_Body::kick(Vector<Body> &r_i, const Vector<Body> &a, double h) {
+  for (int i = 0; i < r_i.getDim(); i++) {
+    r_i[i].velocity += h * a[i].velocity;
+  }
+}
+
+void N_Body::rhsFromAcceleration(const Vector<Body> &r_i,
+                                 const Vector<Body> &a, Vector<Body> &out) {
+  for (int i = 0; i < r_i.getDim(); i++) {
+    out[i].velocity = a[i].velocity;
+    out[i].mass = 0;
+    out[i].objectID = r_i[i].objectID;
+    out[i].position = r_i[i].velocity;
+  }
+}
+
+double N_Body::energy(const Vector<Body> &r_i) const {
+  double kinetic = 0, potential = 0;
+  double eps2 = this->softening * this->softening;
+  for (int i = 0; i < r_i.getDim(); i++) {
+    const Body &a = r_i[i];
+    kinetic += 0.5 * a.mass *
+               (a.velocity[0] * a.velocity[0] + a.velocity[1] * a.velocity[1]);
+    for (int j = i + 1; j < r_i.getDim(); j++) {
+      const Body &b = r_i[j];
+      double dx = a.position[0] - b.position[0];
+      double dy = a.position[1] - b.position[1];
+      potential -= this->gravity * a.mass * b.mass /
+                   std::sqrt(dx * dx + dy * dy + eps2);
+    }
+  }
+  return kinetic + potential;
+}
+
+// all pairs, every pair is evaluated once and applied to both bodies
+void N_Body::accelerationsDirect(const Vector<Body> &r_i,
+                                 Vector<Body> &out) const {
+  int n = r_i.getDim();
+  double eps2 = this->softening * this->softening;
+  for (int i = 0; i < n; i++) {
+    double xi = r_i[i].position[0], yi = r_i[i].position[1];
+    double mi = r_i[i].mass;
+    double axi = 0, ayi = 0;
+    for (int j = i + 1; j < n; j++) {
+      double dx = r_i[j].position[0] - xi;
+      double dy = r_i[j].position[1] - yi;
+      double d2 = dx * dx + dy * dy + eps2;
+      // coincident bodies without softening, skipped like in Barnes-Hut
+      if (d2 == 0) {
+        continue;
+      }
+      double invD = 1 / std::sqrt(d2);
+      double f = this->gravity * invD * invD * invD;
+      axi += r_i[j].mass * f * dx;
+      ayi += r_i[j].mass * f * dy;
+      out[j].velocity[0] -= mi * f * dx;
+      out[j].velocity[1] -= mi * f * dy;
+    }
+    out[i].velocity[0] += axi;
+    out[i].velocity[1] += ayi;
+  }
+}
+
+void N_Body::buildTree(const Vector<Body> &r_i) {
+  int n = r_i.getDim();
+  double minX = r_i[0].position[0], maxX = minX;
+  double minY = r_i[0].position[1], maxY = minY;
+  for (int i = 1; i < n; i++) {
+    minX = std::min(minX, r_i[i].position[0]);
+    maxX = std::max(maxX, r_i[i].position[0]);
+    minY = std::min(minY, r_i[i].position[1]);
+    maxY = std::max(maxY, r_i[i].position[1]);
+  }
+  QuadNode root;
+  root.centerX = (minX + maxX) / 2;
+  root.centerY = (minY + maxY) / 2;
+  // slightly enlarged so bodies on the boundary fall inside
+  root.halfSize = std::max(maxX - minX, maxY - minY) / 2 * (1 + 1e-9) + 1e-300;
+
+  this->nodes.clear();
+  this->nodes.push_back(root);
+  for (int i = 0; i < n; i++) {
+    insert(r_i, i);
+  }
+  for (QuadNode &node : this->nodes) {
+    if (node.mass > 0) {
+      node.comX /= node.mass;
+      node.comY /= node.mass;
+    }
+  }
+}
+
+// descends from the root to the leaf of body b, splitting occupied leaves.
+// Every node on the way accumulates the mass and mass weighted position
+void N_Body::insert(const Vector<Body> &r_i, int b) {
+  const int maxDepth = 64;
+  double x = r_i[b].position[0], y = r_i[b].position[1];
+  double m = r_i[b].mass;
+  int k = 0;
+  for (int depth = 0;; depth++) {
+    QuadNode &node = this->nodes[k];
+    if (node.firstChild < 0) {
+      if (node.body < 0 && node.mass == 0) {
+        node.body = b;
+        node.mass = m;
+        node.comX = m * x;
+        node.comY = m * y;
+        return;
+      }
+      if (depth >= maxDepth) {
+        // (nearly) coincident bodies, merge them into this leaf
+        node.mass += m;
+        node.comX += m * x;
+        node.comY += m * y;
+        return;
+      }
+      // split the leaf and push its body one level down
+      int resident = node.body;
+      int firstChild = this->nodes.size();
+      double half = node.halfSize / 2;
+      double cx = node.centerX, cy = node.centerY;
+      node.firstChild = firstChild;
+      node.body = -1;
+      for (int q = 0; q < 4; q++) {
+        QuadNode child;
+        child.centerX = cx + ((q & 1) ? half : -half);
+        child.centerY = cy + ((q & 2) ? half : -half);
+        child.halfSize = half;
+        this->nodes.push_back(child);
+      }
+      // node is invalidated by push_back, address the arena by index
+      const Body &r = r_i[resident];
+      int q = (r.position[0] >= cx) + 2 * (r.position[1] >= cy);
+      QuadNode &target = this->nodes[firstChild + q];
+      target.body = resident;
+      target.mass = r.mass;
+      target.comX = r.mass * r.position[0];
+      target.comY = r.mass * r.position[1];
+    }
+    QuadNode &current = this->nodes[k];
+    current.mass += m;
+    current.comX += m * x;
+    current.comY += m * y;
+    int q = (x >= current.centerX) + 2 * (y >= current.centerY);
+    k = current.firstChild + q;
+  }
+}
+
+void N_Body::accelerationsBarnesHut(const Vector<Body> &r_i,
+                                    Vector<Body> &out) {
+  int n = r_i.getDim();
+  if (n == 0) {
+    return;
+  }
+  buildTree(r_i);
+  double eps2 = this->softening * this->softening;
+  double theta2 = this->theta * this->theta;
+  for (int i = 0; i < n; i++) {
+    double xi = r_i[i].position[0], yi = r_i[i].position[1];
+    double mi = r_i[i].mass;
+    double ax = 0, ay = 0;
+    // the node on the path of body i from the root to its leaf, found with
+    // the same comparisons as in insert. Its monopole includes body i, so
+    // it is opened whatever theta says, and its leaf is used without body i
+    int own = 0;
+    this->stack.clear();
+    this->stack.push_back(0);
+    while (!this->stack.empty()) {
+      int k = this->stack.back();
+      this->stack.pop_back();
+      const QuadNode &node = this->nodes[k];
+      if (node.mass == 0) {
+        continue;
+      }
+      double mass = node.mass, comX = node.comX, comY = node.comY;
+      if (k == own) {
+        if (node.firstChild >= 0) {
+          own = node.firstChild + (xi >= node.centerX) +
+                2 * (yi >= node.centerY);
+          for (int q = 0; q < 4; q++) {
+            this->stack.push_back(node.firstChild + q);
+          }
+          continue;
+        }
+        // other bodies share the leaf only if merged at the maximum depth
+        mass -= mi;
+        if (!(mass > 0)) {
+          continue;
+        }
+        comX = (node.comX * node.mass - mi * xi) / mass;
+        comY = (node.comY * node.mass - mi * yi) / mass;
+      }
+      double dx = comX - xi;
+      double dy = comY - yi;
+      double d2 = dx * dx + dy * dy;
+      double size = 2 * node.halfSize;
+      if (node.firstChild < 0 || size * size < theta2 * d2) {
+        double r2 = d2 + eps2;
+        if (r2 == 0) {
+          continue;
+        }
+        double invD = 1 / std::sqrt(r2);
+        double f = this->gravity * mass * invD * invD * invD;
+        ax += f * dx;
+        ay += f * dy;
+      } else {
+        for (int q = 0; q < 4; q++) {
+          this->stack.push_back(node.firstChild + q);
+        }
+      }
+    }
+    out[i].velocity[0] += ax;
+    out[i].velocity[1] += ay;
+  }
 }
@@ -0,0 +1,99 @@
+#include <Trajectory.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+TrajectoryReader::TrajectoryReader(const std::string &path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("cannot open " + path);
+  }
+  struct stat info;
+  if (fstat(fd, &info) != 0 ||
+      static_cast<std::size_t>(info.st_size) < sizeof(TrajectoryHeader)) {
+    close(fd);
+    throw std::runtime_error(path + " is no trajectory file");
+  }
+  this->length = info.st_size;
+  void *mapping = mmap(nullptr, this->length, PROT_READ, MAP_SHARED, fd, 0);
+  // the mapping stays valid after the descriptor is closed
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    throw std::runtime_error("cannot map " + path);
+  }
+  this->data = static_cast<const char *>(mapping);
+  this->header = reinterpret_cast<const TrajectoryHeader *>(this->data);
+
+  const TrajectoryHeader &h = *this->header;
+  if (std::memcmp(h.magic, trajectoryMagic, sizeof(trajectoryMagic)) != 0 ||
+      h.version != trajectoryVersion || h.elementSize == 0 ||
+      h.dim > (UINT64_MAX - sizeof(double)) / h.elementSize ||
+      h.recordSize != sizeof(double) + h.dim * h.elementSize) {
+    munmap(const_cast<char *>(this->data), this->length);
+    throw std::runtime_error(path + " is no trajectory file");
+  }
+  // the records and the index of a closed file have to lie within the
+  // mapping. Divisions instead of products, the header may be garbage
+  const std::uint64_t headerSize = sizeof(TrajectoryHeader);
+  std::uint64_t recordsEnd = this->length;
+  if (h.indexOffset != 0) {
+    std::uint64_t nIndex_ =
+        h.indexStride == 0 ? 0
+                           : h.nRecords / h.indexStride +
+                                 (h.nRecords % h.indexStride != 0);
+    this->complete =
+        h.indexStride != 0 && h.indexOffset % 8 == 0 &&
+        h.indexOffset >= headerSize && h.indexOffset <= this->length &&
+        h.nRecords <= (h.indexOffset - headerSize) / h.recordSize &&
+        nIndex_ <= (this->length - h.indexOffset) / sizeof(double);
+    if (this->complete) {
+      this->nRecords = h.nRecords;
+      this->nIndex = nIndex_;
+      this->index =
+          reinterpret_cast<const double *>(this->data + h.indexOffset);
+    } else if (h.indexOffset >= headerSize && h.indexOffset < recordsEnd) {
+      // truncated within the index, what follows the records is no record
+      recordsEnd = h.indexOffset;
+    }
+  }
+  if (!this->complete) {
+    // unfinished or truncated file, use every record that is there entirely
+    this->nRecords = (recordsEnd - headerSize) / h.recordSize;
+    if (h.indexOffset != 0) {
+      this->nRecords =
+          std::min<std::uint64_t>(this->nRecords, h.nRecords);
+    }
+  }
+  madvise(const_cast<char *>(this->data), this->length, MADV_RANDOM);
+}
+
+TrajectoryReader::~TrajectoryReader() {
+  munmap(const_cast<char *>(this->data), this->length);
+}
+
+long TrajectoryReader::find(double t) const {
+  long first = 0, last = this->nRecords;
+  if (this->index) {
+    long block =
+        std::upper_bound(this->index, this->index + this->nIndex, t) -
+        this->index;
+    block = std::max(block - 1, 0L);
+    first = block * this->header->indexStride;
+    last = std::min(last, first + static_cast<long>(this->header->indexStride));
+  }
+  // first record in [first, last) with t_k > t
+  while (first < last) {
+    long mid = first + (last - first) / 2;
+    if (getT(mid) <= t) {
+      first = mid + 1;
+    } else {
+      last = mid;
+    }
+  }
+  return std::max(first - 1, 0L);
+}
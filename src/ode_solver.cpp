@@ -1,6 +1,10 @@
 #include <CLI/CLI.hpp>
+#include <ImplicitSolver.h>
 #include <Problem.h>
 #include <Solver.h>
+#include <Sweep.h>
+#include <Trajectory.h>
+#include <cstdio>
 #include <iostream>
 
 typedef Vector<double> vec;
@@ -9,22 +13,192 @@ enum SOLVER_TYPE { RUNGE_KUTTA_4, LEAP_FROG, EE };
 
 enum SIMULATION_TYPE { LINEAR_ODE, N_BODY };
 
+// integrates the problem for every lambda in lambdas on nThreads threads
+template <typename SolverType>
+void runSweep(const Linear_ODE &problem, const std::vector<double> &lambdas,
+              double stepSize, int maxIterations, double tEnd, int nThreads) {
+  ThreadPool pool(nThreads);
+  spdlog::info("Sweeping {} values of lambda on {} threads", lambdas.size(),
+               pool.size());
+  auto results = parallelSweep(
+      lambdas.size(),
+      [&](int k) {
+        Linear_ODE p = problem;
+        p.lambda = lambdas[k];
+        SolverType solver(p, stepSize, maxIterations);
+        solver.setEndTime(tEnd);
+        return solver;
+      },
+      pool);
+  spdlog::info("\tlambda\t\tt\t\tsteps\t\tr");
+  for (size_t k = 0; k < results.size(); k++) {
+    spdlog::info("\t{}\t\t{}\t\t{}\t\t" + results[k].r.toStr(), lambdas[k],
+                 results[k].t, results[k].steps);
+  }
+}
+
+// prints the header of a trajectory file and its time range
+int inspectTrajectory(const std::string &path) {
+  TrajectoryReader reader(path);
+  const TrajectoryHeader &h = reader.getHeader();
+  std::printf("file        %s\n", path.c_str());
+  std::printf("solver      %s\n", reader.getSolver().c_str());
+  std::printf("description %s\n", reader.getDescription().c_str());
+  std::printf("dim         %d\n", reader.getDim());
+  std::printf("dtype       %u, %lu bytes per element\n", h.dtype,
+              static_cast<unsigned long>(h.elementSize));
+  std::printf("records     %ld of %lu bytes%s\n", reader.size(),
+              static_cast<unsigned long>(h.recordSize),
+              reader.isComplete() ? "" : ", writer not closed");
+  if (reader.size() > 0) {
+    std::printf("t           %.17g ... %.17g\n", reader.getT(0),
+                reader.getT(reader.size() - 1));
+  }
+  return 0;
+}
+
+// writes the records with from <= t <= to, every k-th, as csv lines t,r...
+int exportTrajectory(const std::string &path, const std::string &outPath,
+                     double from, double to, int every) {
+  TrajectoryReader reader(path);
+  if (reader.getHeader().dtype !=
+      static_cast<std::uint32_t>(TrajectoryDtype::FLOAT64)) {
+    spdlog::error("only trajectories of doubles can be exported as csv");
+    return 1;
+  }
+  std::FILE *out = outPath.empty() ? stdout : std::fopen(outPath.c_str(), "w");
+  if (!out) {
+    spdlog::error("cannot open {}", outPath);
+    return 1;
+  }
+  long first = reader.find(from);
+  if (first < reader.size() && reader.getT(first) < from) {
+    first++;
+  }
+  for (long k = first; k < reader.size() && reader.getT(k) <= to;
+       k += std::max(every, 1)) {
+    const double *r = reader.getState<double>(k);
+    std::fprintf(out, "%.17g", reader.getT(k));
+    for (int j = 0; j < reader.getDim(); j++) {
+      std::fprintf(out, ",%.17g", r[j]);
+    }
+    std::fputc('\n', out);
+  }
+  if (out != stdout) {
+    std::fclose(out);
+  }
+  return 0;
+}
+
+// writes every step to writer or, with outputStep > 0, the interpolated
+// states on a grid of that spacing up to tEnd
+template <typename SolverType, typename StateType>
+void addOutput(SolverType &solver, Observer<StateType> &writer,
+               double outputStep, double tEnd) {
+  if (outputStep <= 0) {
+    solver.addObserver(writer);
+    return;
+  }
+  std::vector<double> times;
+  for (long k = 0; k * outputStep <= tEnd * (1 + 1e-12); k++) {
+    times.push_back(solver.getT() + k * outputStep);
+  }
+  solver.setOutputTimes(times, writer);
+}
+
+// integrates two bodies on a circular orbit and reports the energy error
+template <typename SolverType>
+void runNBody(double stepSize, int maxIterations, const std::string &output,
+              double outputStep) {
+  Vector<Body> bodies(2);
+  bodies[0] = Body(0.5, 0.5, 0, 0, 0.5);
+  bodies[1] = Body(0.5, -0.5, 0, 0, -0.5);
+  bodies[1].objectID = 1;
+  N_Body problem(bodies, 0, 1);
+  SolverType solver(problem, stepSize, maxIterations);
+  solver.setStoreHistory(false);
+  std::unique_ptr<TrajectoryWriter<Vector<Body>>> writer;
+  if (!output.empty()) {
+    writer = std::make_unique<TrajectoryWriter<Vector<Body>>>(
+        output, solver.getName(), "two body orbit");
+    addOutput(solver, *writer, outputStep, stepSize * maxIterations);
+  }
+  solver.solve();
+  double e0 = problem.energy(bodies);
+  double e = problem.energy(solver.getR());
+  spdlog::info("energy {} -> {}, relative error {}", e0, e,
+               std::abs((e - e0) / e0));
+}
+
 int main(int argc, char **argv) {
   CLI::App app{"ODE Solver App"};
 
   // Definiere eine optionale Eingabe für eine Zahl
   std::string solverType = "RK4";
   app.add_option("-s,--solver", solverType,
-                 "Input solver type: RUNGE_KUTTA_4, LEAP_FROG, EE");
+                 "Input solver type: RUNGE_KUTTA_4, LEAP_FROG, EE, DP54, BE, "
+                 "BDF2, SDIRK2");
 
   // Definiere eine optionale Eingabe für einen Namen
   std::string problemType;
   app.add_option("-p,--problem", problemType,
                  "Input problem type: LINEAR, N_BODY");
 
+  // Anzahl der Threads, 0 verwendet alle Kerne
+  int nThreads = 0;
+  app.add_option("-t,--threads", nThreads,
+                 "Number of threads for sweeps, 0 uses all cores");
+
+  // Parameterstudie ueber lambda des linearen Problems
+  int sweepSize = 0;
+  double sweepMin = -1;
+  double sweepMax = 1;
+  app.add_option("--sweep", sweepSize,
+                 "Integrate the linear problem for this many values of lambda");
+  app.add_option("--sweep-min", sweepMin, "Smallest lambda of the sweep");
+  app.add_option("--sweep-max", sweepMax, "Largest lambda of the sweep");
+
+  // Trajektorie als Binaerdatei schreiben
+  std::string output;
+  app.add_option("-o,--output", output,
+                 "Write the trajectory of the RK4 run, or of the N_BODY run, "
+                 "to this binary file");
+  // Ausgabe auf einem festen Zeitgitter, unabhaengig von der Schrittweite
+  double outputStep = 0;
+  app.add_option("--output-step", outputStep,
+                 "Write interpolated states every this much time instead of "
+                 "every step");
+
+  // Unterbefehle zum Lesen einer Trajektorie
+  std::string trajectoryPath;
+  CLI::App *inspect =
+      app.add_subcommand("inspect", "Print the header of a trajectory file");
+  inspect->add_option("file", trajectoryPath, "Trajectory file")->required();
+
+  std::string exportPath;
+  double exportFrom = -std::numeric_limits<double>::infinity();
+  double exportTo = std::numeric_limits<double>::infinity();
+  int exportEvery = 1;
+  CLI::App *exportCmd = app.add_subcommand(
+      "export", "Write the records of a trajectory file as csv");
+  exportCmd->add_option("file", trajectoryPath, "Trajectory file")
+      ->required();
+  exportCmd->add_option("-o,--output", exportPath, "csv file, default stdout");
+  exportCmd->add_option("--from", exportFrom, "First time to export");
+  exportCmd->add_option("--to", exportTo, "Last time to export");
+  exportCmd->add_option("--every", exportEvery, "Export every k-th record");
+
   // Parse die Kommandozeilenargumente
   CLI11_PARSE(app, argc, argv);
 
+  if (*inspect) {
+    return inspectTrajectory(trajectoryPath);
+  }
+  if (*exportCmd) {
+    return exportTrajectory(trajectoryPath, exportPath, exportFrom, exportTo,
+                            exportEvery);
+  }
+
   std::vector<double> r0_ = {2};
   vec r0(r0_);
 
@@ -34,8 +208,49 @@ int main(int argc, char **argv) {
   double stepSize = 0.5;
   int maxIterations = 10;
 
+  if (problemType == "N_BODY") {
+    if (solverType == "LEAP_FROG") {
+      runNBody<Leapfrog<N_Body, Body>>(stepSize, maxIterations, output,
+                                       outputStep);
+    } else if (solverType == "EE") {
+      runNBody<ExplicitEuler<N_Body, Body>>(stepSize, maxIterations, output,
+                                            outputStep);
+    } else {
+      runNBody<RungeKutta4<N_Body, Body>>(stepSize, maxIterations, output,
+                                          outputStep);
+    }
+    return 0;
+  }
+
   Linear_ODE problem(r0, t0, lambda);
 
+  if (sweepSize > 0) {
+    std::vector<double> lambdas(sweepSize, sweepMin);
+    for (int k = 1; k < sweepSize; k++) {
+      lambdas[k] = sweepMin + (sweepMax - sweepMin) * k / (sweepSize - 1);
+    }
+    double tEnd = t0 + stepSize * maxIterations;
+    if (solverType == "EE") {
+      runSweep<ExplicitEuler<Linear_ODE, double>>(
+          problem, lambdas, stepSize, maxIterations, tEnd, nThreads);
+    } else if (solverType == "DP54") {
+      runSweep<DormandPrince54<Linear_ODE, double>>(
+          problem, lambdas, stepSize, maxIterations, tEnd, nThreads);
+    } else if (solverType == "BE") {
+      runSweep<BackwardEuler<Linear_ODE, double>>(
+          problem, lambdas, stepSize, maxIterations, tEnd, nThreads);
+    } else if (solverType == "BDF2") {
+      runSweep<BDF2<Linear_ODE, double>>(problem, lambdas, stepSize,
+                                         maxIterations, tEnd, nThreads);
+    } else if (solverType == "SDIRK2") {
+      runSweep<SDIRK2<Linear_ODE, double>>(problem, lambdas, stepSize,
+                                           maxIterations, tEnd, nThreads);
+    } else {
+      runSweep<RungeKutta4<Linear_ODE, double>>(
+          problem, lambdas, stepSize, maxIterations, tEnd, nThreads);
+    }
+    return 0;
+  }
 
   RungeKutta4<Linear_ODE, double> rk4_solver(problem, stepSize, maxIterations);
   spdlog::info("RK4 instansiated");
@@ -45,6 +260,17 @@ int main(int argc, char **argv) {
 
   rk4_solver.setPrint(true);
   ee_solver.setPrint(true);
+  // the states are printed and written by the writer, no need to keep them
+  rk4_solver.setStoreHistory(false);
+  ee_solver.setStoreHistory(false);
+
+  std::unique_ptr<TrajectoryWriter<vec>> writer;
+  if (!output.empty()) {
+    writer = std::make_unique<TrajectoryWriter<vec>>(
+        output, rk4_solver.getName(),
+        "linear ode, lambda " + std::to_string(lambda));
+    addOutput(rk4_solver, *writer, outputStep, stepSize * maxIterations);
+  }
 
   rk4_solver.solve();
   ee_solver.solve();